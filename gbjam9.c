@@ -1,12 +1,22 @@
+#include <gb/cgb.h>
 #include <gb/console.h>
 #include <gb/gb.h>
 #include <gb/metasprites.h>
 #include <rand.h>
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "metasprites/bird.h"
 
+#include "hiscore.h"
+#include "link.h"
+#include "particles.h"
+#include "physics.h"
+#include "raster.h"
+#include "telemetry.h"
+#include "text.h"
+#include "vram.h"
+
 #include "tilesets/food_tiles.h"
 #include "tilesets/title_tiles.h"
 #include "tilesets/title_map.h"
@@ -21,6 +31,11 @@
 
 
 #define SHOW_FPS 0
+#if PHYSICS_PROFILE && (RASTER_PROFILE || SHOW_FPS)
+    #error "PHYSICS_PROFILE prints where RASTER_PROFILE and SHOW_FPS do, enable only one of them"
+#endif
+// Keep the last shadow OAM contents of the game screen in a ring buffer, for tools/oamscan
+#define OAM_TRACE 0
 
 
 // Pause sprite tiles are loaded into VRAM
@@ -58,19 +73,49 @@
 #define FOOD_TILE_NUM_START (BIRD_TILE_NUM_START + (sizeof(bird_data) >> 4))
 // Food metasprite will be built starting with hardware sprite 9 (after character sprites)
 #define FOOD_SPR_NUM_START (BIRD_SPR_NUM_START + 4)
+// Other player's bird in versus mode, after food sprites, with lighter shades (OBP1 on DMG, palette 1 on CGB)
+#define OTHER_BIRD_SPR_NUM_START (FOOD_SPR_NUM_START + 2*MAX_FOOD)
+#define OTHER_BIRD_PROPS (S_PALETTE | 0x01)
+
+// Particle tiles are loaded into VRAM after sky tiles (font tiles are at the end of the tiles space, see text.h)
+#define PARTICLE_TILE_NUM_START sky_tiles_count
+#if PARTICLE_TILE_NUM_START + PARTICLE_POOL_SIZE > FONT_TILE_NUM_START
+    #error "tilesets/sky.png leaves no room for particle tiles before the font"
+#endif
 
 #define INITIAL_COUNTDOWN_SETTING 3
 
+// Title screen sleeps after showing its shimmer for this many frames (it freezes then), see idleAllowed
+#define TITLE_IDLE_AFTER 300
+
+#define GAME_INTERRUPTS (VBL_IFLAG | LCD_IFLAG | SIO_IFLAG)
+
 joypads_t joypads, prevJoypads;
 uint16_t frame = 0;
-uint16_t lastInputFrame = 0;
 uint16_t lastAudioLoopFrame = 0;
 uint8_t vblanks = 0;
 #if SHOW_FPS
     uint16_t lastVBlankFrame = 0;
     uint8_t fps = 0;
 #endif
+#if OAM_TRACE
+    // Found in memory dumps by its signature, see tools/oamscan.c for the layout
+    #define OAM_TRACE_FRAMES 16
+    typedef struct oam_trace_entry_t {
+        uint32_t sequence;      // Traced frames counter, 0 for unused entries
+        uint8_t oam[160];
+    } oam_trace_entry_t;
+    typedef struct oam_trace_t {
+        char magic[4];          // "OAMT"
+        uint8_t frames;         // Number of entries
+        uint8_t head;           // Next entry to write
+        uint32_t sequence;
+        oam_trace_entry_t entries[OAM_TRACE_FRAMES];
+    } oam_trace_t;
+    oam_trace_t oamTrace = { .magic = { 'O', 'A', 'M', 'T' }, .frames = OAM_TRACE_FRAMES };
+#endif
 uint8_t paused = 0;
+uint8_t cgbMode = 0;    // Running on a Game Boy Color, in double-speed mode
 
 // Screens state machine
 typedef enum screen_t {
@@ -81,21 +126,11 @@ typedef enum screen_t {
 } screen_t;
 screen_t screen = TITLE_SCREEN;
 
-// Character position
-int16_t posX = 0, posY = 0;
-int16_t pixelPosX = 0, pixelPosY = 0;
-int16_t speedX = 0, speedY = 0;
-uint8_t scrollY = 0;
-uint8_t charSpriteIdx = 0;
-uint16_t animationLastFrame = 0;
-uint32_t score = 0;
-uint8_t scoreTiles[5] = { sky_tiles_count, sky_tiles_count, sky_tiles_count, sky_tiles_count, sky_tiles_count };
+uint8_t scrollY = 0;        // Displayed background scroll, following the local player
 uint8_t countdownSetting = 0;
+uint8_t newHiscore = 0;
 uint16_t countdown = 0;
-uint8_t countdownTiles[3] = { sky_tiles_count, sky_tiles_count, sky_tiles_count };
-#if SHOW_FPS
-    uint8_t fpsTiles[2] = { sky_tiles_count, sky_tiles_count };
-#endif
+uint8_t versus = 0;         // Link cable game: both consoles simulate both players in lockstep
 
 // State machine
 typedef enum status_t {
@@ -104,29 +139,57 @@ typedef enum status_t {
     FLAPPING,
     DIVING
 } status_t;
-status_t charStatus = GLIDING;
+// Maximum downwards speed in each state
+const int8_t maxSpeedY[] = { MAX_SPEED_Y_GLIDING, MAX_SPEED_Y_GLIDING, MAX_SPEED_Y_GLIDING, MAX_SPEED_Y_DIVING };
+
+// Players: a single one in solo mode, master then slave console in versus mode
+#define MAX_PLAYERS 2
+typedef struct player_t {
+    fixed_t posX, posY;
+    uint8_t speedX;             // Horizontal speed magnitude
+    uint8_t movingRight;        // Horizontal speed direction
+    int8_t speedY;
+    uint8_t scrollY;            // Background scroll following this player, used to catch food
+    status_t charStatus;
+    uint8_t charSpriteIdx;
+    uint16_t animationLastFrame;
+    uint16_t lastInputFrame;
+    uint8_t joy, prevJoy;       // Inputs applied this frame and the previous one
+    uint32_t score;
+} player_t;
+player_t players[MAX_PLAYERS];
+uint8_t playersCount = 1;
+uint8_t localPlayer = 0;
 
 // Food
 typedef enum food_type_t {
     DANDELION,
     BERRY
 } food_type_t;
-typedef struct food_t {
-    uint8_t enabled;
-    food_type_t type;
+// Per-type properties, indexed by food_type_t
+typedef struct food_kind_t {
     uint8_t spriteOffset;
     uint8_t spriteCount;
     uint8_t spriteHeight;
+    int8_t value;
+} food_kind_t;
+const food_kind_t foodKinds[] = {
+    { .spriteOffset=0, .spriteCount=3, .spriteHeight=2, .value=10 },    // DANDELION
+    { .spriteOffset=6, .spriteCount=8, .spriteHeight=1, .value=100 }    // BERRY
+};
+typedef struct food_t {
+    uint8_t enabled;
+    food_type_t type;
+    const food_kind_t* kind;
     uint8_t spriteIdx;
     uint16_t animationLastFrame;
-    int16_t posX, posY;
-    int16_t pixelPosX, pixelPosY;
-    int16_t speedX, speedY;
-    int8_t value;
+    fixed_t posX, posY;
+    int8_t speedX, speedY;
 } food_t;
 food_t food[MAX_FOOD];
 
 // Music
+// Timings are counted in frames, so they don't depend on the CPU speed (the LCD and sound hardware aren't affected by double-speed mode)
 #define MUSIC_TONES_COUNT 64
 #define MUSIC_DELAY 20
 #define SIXTEENTH_NOTE_DURATION 8
@@ -214,32 +277,79 @@ tone_t music[MUSIC_TONES_COUNT] = {
 };
 uint16_t nextSound = 0;
 
+// Sprite palettes as last set or queued, and whether they still have to be written at next VBlank
+uint8_t spritePalettes[2] = { 0xE4, 0xE4 };
+volatile uint8_t spritePalettesPending[2] = { 0, 0 };
+
+// CGB palettes: grey shades for the DMG color indexes (white to black)
+const uint16_t cgbShades[4] = { RGB(31, 31, 31), RGB(21, 21, 21), RGB(10, 10, 10), RGB(0, 0, 0) };
+
+
+// CGB mode ignores the DMG palette registers, so DMG palettes are also converted into the first CGB palettes
+void dmgToCgbPalette(uint8_t value, uint16_t* colors) {
+    for (uint8_t i = 0; i < 4; i++, value >>= 2) {
+        colors[i] = cgbShades[value & 0x03];
+    }
+}
+void setBkgPalette(uint8_t value) {
+    BGP_REG = value;
+    if (cgbMode) {
+        uint16_t colors[4];
+        dmgToCgbPalette(value, colors);
+        set_bkg_palette(0, 1, colors);
+    }
+}
+// Right away: while the display is off, or during VBlank
+void setSpritePalette(uint8_t palette, uint8_t value) {
+    spritePalettes[palette] = value;
+    spritePalettesPending[palette] = 0;
+    if (palette == 0) {
+        OBP0_REG = value;
+    } else {
+        OBP1_REG = value;
+    }
+    if (cgbMode) {
+        uint16_t colors[4];
+        dmgToCgbPalette(value, colors);
+        set_sprite_palette(palette, 1, colors);
+    }
+}
+// From the main loop: CGB palette RAM can't be written while the LCD draws a line (mode 3),
+// so changes are written by the VBlank interrupt
+void queueSpritePalette(uint8_t palette, uint8_t value) {
+    if (value != spritePalettes[palette]) {
+        spritePalettes[palette] = value;
+        spritePalettesPending[palette] = 1;
+    }
+}
+
 
 void initScreen() {
     DISPLAY_OFF;
+    telemetryLoadStart();
 
     // Init palettes
-    BGP_REG = 0xE4;     // BG Palette : Black, Dark gray, Light gray, White
-    OBP0_REG = 0xE4;    // Sprite palette 0 : Black, Dark gray, Light gray, Transparent
-    OBP1_REG = 0xE4;    // Sprite palette 1 : Black, Dark gray, Light gray, Transparent
+    setBkgPalette(0xE4);        // BG Palette : Black, Dark gray, Light gray, White
+    setSpritePalette(0, 0xE4);  // Sprite palette 0 : Black, Dark gray, Light gray, Transparent
+    setSpritePalette(1, 0xE4);  // Sprite palette 1 : Black, Dark gray, Light gray, Transparent
 
     switch (screen) {
         case TITLE_SCREEN: {
             // Background tilemap
-            set_bkg_data(0, title_tiles_count, title_tiles);
+            uploadBkgData(0, title_tiles_count, title_tiles);
             set_bkg_tiles(0, 0, title_map_width, title_map_height, title_map);
 
             // Font tiles
-            set_bkg_data(title_tiles_count, font_tiles_count, font_tiles);
+            uploadBkgData(FONT_TILE_NUM_START, font_tiles_count, font_tiles);
 
             // Press start
-            const unsigned char pressTiles[5] = { title_tiles_count + 11, title_tiles_count + 12, title_tiles_count + 13, title_tiles_count + 14, title_tiles_count + 14 };
-            set_bkg_tiles(2, 12, 5, 1, pressTiles);
-            const unsigned char startTiles[5] = { title_tiles_count + 14, title_tiles_count + 15, title_tiles_count + 16, title_tiles_count + 12, title_tiles_count + 15 };
-            set_bkg_tiles(3, 14, 5, 1, startTiles);
+            PRINT_TEXT(TEXT_BKG, 2, 12, press);
+            PRINT_TEXT(TEXT_BKG, 3, 14, start);
 
             // Reset background scroll
             move_bkg(0, 0);
+            setRasterScroll(0, 0);
+            setRasterEffect(RASTER_TITLE_SHIMMER);
 
             // Show background
             SHOW_BKG; HIDE_WIN; HIDE_SPRITES;
@@ -253,14 +363,16 @@ void initScreen() {
         }
         case INSTRUCTIONS_SCREEN: {
             // Background tilemap
-            set_bkg_data(0, instructions_tiles_count, instructions_tiles);
+            uploadBkgData(0, instructions_tiles_count, instructions_tiles);
             set_bkg_tiles(0, 0, instructions_map_width, instructions_map_height, instructions_map);
 
-            // Font tiles
-            set_sprite_data(0, font_tiles_count, font_tiles);
+            // Font tiles, used by the duration sprite
+            uploadSpriteData(FONT_TILE_NUM_START, font_tiles_count, font_tiles);
 
             // Reset background scroll
             move_bkg(0, 0);
+            setRasterScroll(0, 0);
+            setRasterEffect(RASTER_NONE);
 
             // Reset hardware sprites
             for (uint8_t i = 0; i < 40; i++) {
@@ -281,33 +393,50 @@ void initScreen() {
                 countdownSetting = INITIAL_COUNTDOWN_SETTING;
             }
             frame = 0;
+
+            // Answer a versus game hosted on the other console
+            versus = 0;
+            linkListen();
             break;
         }
         case GAME_SCREEN: {
             // Background tilemap
-            set_bkg_data(0, sky_tiles_count, sky_tiles);
+            uploadBkgData(0, sky_tiles_count, sky_tiles);
             set_bkg_tiles(0, 0, sky_map_width, sky_map_height, sky_map);
+            // Repeat edge columns just outside of the screen, revealed when cloud layers sway
+            for (uint8_t y = 0; y < sky_map_height; y++) {
+                set_bkg_tiles(sky_map_width, y, 1, 1, &sky_map[(uint16_t)y * sky_map_width + sky_map_width - 1]);
+                set_bkg_tiles(31, y, 1, 1, &sky_map[(uint16_t)y * sky_map_width]);
+            }
             
             // HUD
-            set_win_data(sky_tiles_count, font_tiles_count, font_tiles);
-            set_win_tiles(14, 0, 5, 1, scoreTiles);
-            set_win_tiles(1, 0, 3, 1, countdownTiles);
+            uploadBkgData(FONT_TILE_NUM_START, font_tiles_count, font_tiles);
+            printNumber(TEXT_WIN, 14, 0, 0, 5);
+            if (versus) {
+                printNumber(TEXT_WIN, 8, 0, 0, 5);
+            }
+            printNumber(TEXT_WIN, 1, 0, countdownSetting * 60, 3);
             #if SHOW_FPS
-                set_win_tiles(9, 0, 2, 1, fpsTiles);
+                printNumber(TEXT_WIN, 9, 0, 0, 2);
             #endif
             move_win(7, 136);
 
+            // Particles are drawn over sky tiles
+            initParticles(PARTICLE_TILE_NUM_START, sky_tiles, sky_map, sky_map_width, sky_map_height);
+
             // Load character metasprite tile data into VRAM
-            set_sprite_data(BIRD_TILE_NUM_START, sizeof(bird_data) >> 4, bird_data);
+            uploadSpriteData(BIRD_TILE_NUM_START, sizeof(bird_data) >> 4, bird_data);
 
             // Load food metasprites tile data into VRAM
-            set_sprite_data(FOOD_TILE_NUM_START, food_tiles_count, food_tiles);
+            uploadSpriteData(FOOD_TILE_NUM_START, food_tiles_count, food_tiles);
 
             // Load pause sprites tile data into VRAM
-            set_sprite_data(PAUSE_TILE_NUM_START, pause_tiles_count, pause_tiles);
+            uploadSpriteData(PAUSE_TILE_NUM_START, pause_tiles_count, pause_tiles);
 
             // Reset background scroll
             move_bkg(0, 0);
+            setRasterScroll(0, 0);
+            setRasterEffect(RASTER_SKY_CLOUDS);
 
             // Reset hardware sprites
             for (uint8_t i = 0; i < 40; i++) {
@@ -325,17 +454,28 @@ void initScreen() {
             NR50_REG = 0x77; // Max volume on L/R outputs
             NR51_REG = 0xFF; // All 4 channels to both L/R outputs
         
-            // Set initial state
-            posX = posY = 64 << 4;
-            pixelPosX = pixelPosY = 64;
-            speedX = INITIAL_SPEED_X;
-            speedY = INITIAL_SPEED_Y;
+            // Set initial state (the whole simulation state, so that both consoles start identical in versus mode)
+            playersCount = versus ? 2 : 1;
+            localPlayer = (versus && linkRole == LINK_SLAVE) ? 1 : 0;
+            for (uint8_t i = 0; i < playersCount; i++) {
+                player_t* p = &players[i];
+                FIXED_SET(p->posX, i ? 96 : 64);
+                FIXED_SET(p->posY, 64);
+                p->speedX = INITIAL_SPEED_X;
+                p->movingRight = !i;
+                p->speedY = INITIAL_SPEED_Y;
+                p->scrollY = 0;
+                p->charStatus = GLIDING;
+                p->charSpriteIdx = BIRD_SPRITE_GLIDING;
+                p->animationLastFrame = 0;
+                p->lastInputFrame = 0;
+                p->joy = 0;
+                p->prevJoy = 0;
+                p->score = 0;
+            }
             scrollY = 0;
-            charSpriteIdx = BIRD_SPRITE_GLIDING;
-            score = 0;
             countdown = countdownSetting * 60;
             frame = 0;
-            lastInputFrame = 0;
             lastAudioLoopFrame = 0;
             vblanks = 0;
             paused = 0;
@@ -344,35 +484,46 @@ void initScreen() {
             }
             nextSound = 0;
 
-            // Initialize random number generator
-            initrand(DIV_REG);
+            if (versus) {
+                setSpritePalette(1, 0x90);  // Sprite palette 1 : Dark gray, Light gray, White, Transparent
+                linkStartGame();
+            } else {
+                linkStop();
+            }
+
+            // Initialize random number generator, with the seed agreed on by both consoles in versus mode
+            initrand(versus ? linkSeed : DIV_REG);
             break;
         }
         case WINNING_SCREEN: {
             // Background tilemap
-            set_bkg_data(0, winning_tiles_count, winning_tiles);
+            uploadBkgData(0, winning_tiles_count, winning_tiles);
             set_bkg_tiles(0, 0, winning_map_width, winning_map_height, winning_map);
 
             // Font tiles
-            set_bkg_data(winning_tiles_count, font_tiles_count, font_tiles);
+            uploadBkgData(FONT_TILE_NUM_START, font_tiles_count, font_tiles);
 
             // Score
-            unsigned char finalScoreTiles[5] = { winning_tiles_count, winning_tiles_count, winning_tiles_count, winning_tiles_count, winning_tiles_count };
-            const char str[6];  // Maximum 5 characters + null terminator
-            sprintf(str, "%d", score);
-            // Pad with zeros
-            int c = -1;
-            while(str[++c] != '\0');
-            for (int ch=0; ch<(5-c); ch++) {
-                finalScoreTiles[ch] = winning_tiles_count;
-            }
-            for (int ch=(5-c); ch<5; ch++) {
-                finalScoreTiles[ch] = winning_tiles_count + str[ch-(5-c)] - 0x30;
+            printNumber(TEXT_BKG, 5, 14, players[localPlayer].score, 5);
+
+            if (versus) {
+                // Other player's score
+                if (localPlayer) {
+                    PRINT_TEXT(TEXT_BKG, 0, 16, p1);
+                } else {
+                    PRINT_TEXT(TEXT_BKG, 0, 16, p2);
+                }
+                printNumber(TEXT_BKG, 5, 16, players[!localPlayer].score, 5);
+            } else {
+                // Best score for this game duration (blinks when it was just beaten)
+                PRINT_TEXT(TEXT_BKG, 0, 16, best);
+                printNumber(TEXT_BKG, 5, 16, getHiscore(countdownSetting), 5);
             }
-            set_bkg_tiles(5, 14, 5, 1, finalScoreTiles);
 
             // Reset background scroll
             move_bkg(0, 0);
+            setRasterScroll(0, 0);
+            setRasterEffect(RASTER_NONE);
 
             // Show background
             SHOW_BKG; HIDE_WIN; HIDE_SPRITES;
@@ -385,9 +536,18 @@ void initScreen() {
             break;
         }
     }
+    // Display is off, queued text can be written right away
+    flushText();
+    telemetryLoadEnd(screen);
     DISPLAY_ON;
 }
 
+// A feather falls from the bird, drifting backwards
+void spawnFeather(player_t* p) {
+    // Bird metasprite pivot is its center, sprite coordinates are offset by (8, 16) from the background
+    spawnParticle(FEATHER, p->posX.pixel - 8, p->posY.pixel - 12 + p->scrollY, p->movingRight ? -4 : 4, 6);
+}
+
 uint8_t justPressed() {
     return (joypads.joy0 ^ prevJoypads.joy0) & joypads.joy0;
 }
@@ -403,34 +563,14 @@ int8_t nextAvailableFoodSlot() {
     while (slot < maxAvailable && food[slot].enabled != 0) {
         slot++;
     }
-    if (slot < maxAvailable) return slot;
-    else return -1;
-}
-
-uint8_t collideWithChar(int16_t foodPixelPosX, int16_t foodPixelPosY, uint8_t foodSpriteHeight) {
-    // Metasprite origin is the pivot point
-    int16_t charX = pixelPosX - bird_PIVOT_X;
-    int16_t charY = pixelPosY - bird_PIVOT_Y;
-    int16_t foodY = foodPixelPosY - scrollY;  // Need to account for background scroll
-    return (foodPixelPosX < (charX + 16) && (foodPixelPosX + 8) > charX && foodY < (charY + 16) && (foodY + 8*foodSpriteHeight) > charY);
-}
-
-void printInWindowHeader(uint8_t* tiles, uint8_t x, uint8_t characters, uint32_t value) {
-    const char str[6];  // Maximum 5 characters + null terminator
-    sprintf(str, "%d", value);
-    // Pad with zeros
-    int c = -1;
-    while(str[++c] != '\0');
-    for (int ch=0; ch<(characters-c); ch++) {
-        tiles[ch] = sky_tiles_count;
-    }
-    for (int ch=(characters-c); ch<characters; ch++) {
-        tiles[ch] = sky_tiles_count + str[ch-(characters-c)] - 0x30;
+    TELEMETRY->spawnAttempts++;
+    if (slot < maxAvailable) {
+        TELEMETRY->spawnSlots++;
+        return slot;
     }
-    set_win_tiles(x, 0, characters, 1, tiles);
+    return -1;
 }
 
-
 void titleScreen() {
     // Poll joypad
     prevJoypads = joypads;
@@ -472,6 +612,26 @@ void instructionsScreen() {
         }
     }
 
+    // Select hosts a versus game on the link cable (with this duration setting), or cancels it
+    if (frame >= 30 && (pressed & J_SELECT)) {
+        if (linkHosting()) {
+            linkListen();
+        } else {
+            linkHost(((uint16_t)DIV_REG << 8) | (uint8_t)frame, countdownSetting);
+        }
+    }
+    // One handshake byte per frame while hosting
+    linkPump();
+
+    // Both consoles go to the game screen as soon as the handshake is done
+    if (linkReady()) {
+        versus = 1;
+        countdownSetting = linkSetting;
+        screen = GAME_SCREEN;   // FIXME Transition
+        initScreen();
+        return;
+    }
+
     // Start, A, or B goes to the game screen
     if (frame >= 30 && ((pressed & J_START) || (pressed & J_A) || (pressed & J_B))) {
         screen = GAME_SCREEN;   // FIXME Transition
@@ -479,63 +639,38 @@ void instructionsScreen() {
         return;
     }
 
-    // Display game duration setting
-    set_sprite_tile(0, countdownSetting);
-    if (frame == 0) {   // Move only once
-        move_sprite(0, 69, 112);
-    }
+    // Display game duration setting, blinking while waiting for the other console
+    set_sprite_tile(0, FONT_DIGIT_START + countdownSetting);
+    move_sprite(0, 69, (linkHosting() && (frame & 0x10)) ? 0 : 112);
 
     frame++;
 }
 
 
-void gameScreen() {
-    // Poll joypad
-    prevJoypads = joypads;
-    joypad_ex(&joypads);
-    uint8_t pressed = justPressed();
-    uint8_t pushed = joypads.joy0;
-    uint8_t released = justReleased();
+// Movements and actions of a player for this frame, from its inputs. Returns 1 when its bird needs to be redrawn.
+uint8_t updatePlayer(player_t* p) {
+    uint8_t pressed = (p->joy ^ p->prevJoy) & p->joy;
+    uint8_t pushed = p->joy;
+    uint8_t released = (p->joy ^ p->prevJoy) & p->prevJoy;
 
     // Store previous values
-    int16_t prevPixelPosX = pixelPosX;
-    int16_t prevPixelPosY = pixelPosY;
-    uint8_t prevScrollY = scrollY;
-    uint32_t prevScore = score;
-    uint16_t prevCountdown = countdown;
-
-    if (pressed & J_START) {
-        if (paused) {
-            paused = 0;
-            for (int c=0; c<5; c++) {
-                shadow_OAM[PAUSE_SPR_NUM_START + c].y = 0;
-            }
-        } else {
-            paused = 1;
-            for (int c=0; c<5; c++) {
-                set_sprite_tile(PAUSE_SPR_NUM_START + c, PAUSE_TILE_NUM_START + c);
-                move_sprite(PAUSE_SPR_NUM_START + c, 68 + c*8, 84);
-            }
-        }
-    }
-
-    // Show pause
-    if (paused) {
-        return;
-    }
+    uint8_t prevPixelPosX = p->posX.pixel;
+    uint8_t prevPixelPosY = p->posY.pixel;
 
     if (pressed || pushed) {
-        lastInputFrame = frame;
+        p->lastInputFrame = frame;
     }
     
     // Switch direction, speed is slowed down
-    if ((pressed & J_LEFT) && speedX > 0) {
-        speedX = -INITIAL_SPEED_X;
-    } else if ((pressed & J_RIGHT) && speedX < 0) {
-        speedX = INITIAL_SPEED_X;
+    if ((pressed & J_LEFT) && p->movingRight) {
+        p->speedX = INITIAL_SPEED_X;
+        p->movingRight = 0;
+    } else if ((pressed & J_RIGHT) && !p->movingRight) {
+        p->speedX = INITIAL_SPEED_X;
+        p->movingRight = 1;
     }
 
-    switch (charStatus) {
+    switch (p->charStatus) {
         case IDLING:
             // TODO When resting on a platform???
             break;
@@ -543,131 +678,233 @@ void gameScreen() {
             // Handle buttons: flapping with A, diving with DOWN
             if (pressed & J_A) {
                 // Push upwards
-                speedY += SPEED_Y_BOOST_FLAPPING;
-                charStatus = FLAPPING;
+                p->speedY += SPEED_Y_BOOST_FLAPPING;
+                p->charStatus = FLAPPING;
+                spawnFeather(p);
                 break;
             } else if (pushed & J_DOWN) {
                 // Dive
-                speedY += SPEED_Y_BOOST_DIVING;
-                charStatus = DIVING;
+                p->speedY += SPEED_Y_BOOST_DIVING;
+                p->charStatus = DIVING;
                 break;
-            } else if (charSpriteIdx != BIRD_SPRITE_GLIDING) {
-                charSpriteIdx = BIRD_SPRITE_GLIDING;
+            } else if (p->charSpriteIdx != BIRD_SPRITE_GLIDING) {
+                p->charSpriteIdx = BIRD_SPRITE_GLIDING;
             }
             // Horizontal speed increases slightly while gliding
-            if (abs(speedX) < MAX_SPEED_X) {
-                speedX = speedX > 0 ? speedX + 1 : speedX - 1;
+            if (p->speedX < MAX_SPEED_X) {
+                p->speedX += 1;
             }
             break;
         case FLAPPING:
             // Display flapping animation
-            if (charSpriteIdx < BIRD_SPRITE_FLAPPING_START || charSpriteIdx > BIRD_SPRITE_FLAPPING_END) {
-                animationLastFrame = frame;
-                charSpriteIdx = BIRD_SPRITE_GLIDING;
-            } else if (frame - animationLastFrame > 2) {
-                animationLastFrame = frame;
-                charSpriteIdx++;
-                if (charSpriteIdx > BIRD_SPRITE_FLAPPING_END) {
-                    charSpriteIdx = BIRD_SPRITE_FLAPPING_START;
-                } else if (charSpriteIdx == BIRD_SPRITE_GLIDING) {
+            if (p->charSpriteIdx < BIRD_SPRITE_FLAPPING_START || p->charSpriteIdx > BIRD_SPRITE_FLAPPING_END) {
+                p->animationLastFrame = frame;
+                p->charSpriteIdx = BIRD_SPRITE_GLIDING;
+            } else if (frame - p->animationLastFrame > 2) {
+                p->animationLastFrame = frame;
+                p->charSpriteIdx++;
+                if (p->charSpriteIdx > BIRD_SPRITE_FLAPPING_END) {
+                    p->charSpriteIdx = BIRD_SPRITE_FLAPPING_START;
+                } else if (p->charSpriteIdx == BIRD_SPRITE_GLIDING) {
                     // Go back to gliding when animation finishes
-                    charStatus = GLIDING;
+                    p->charStatus = GLIDING;
                 }
             }
             break;
         case DIVING:
             // Display diving animation
-            if (charSpriteIdx < BIRD_SPRITE_DIVING_START || charSpriteIdx > BIRD_SPRITE_DIVING_END) {
-                animationLastFrame = frame;
-                charSpriteIdx = BIRD_SPRITE_DIVING_START;
-            } else if (charSpriteIdx < BIRD_SPRITE_DIVING_END && frame - animationLastFrame > 2) {
-                animationLastFrame = frame;
-                charSpriteIdx++;
+            if (p->charSpriteIdx < BIRD_SPRITE_DIVING_START || p->charSpriteIdx > BIRD_SPRITE_DIVING_END) {
+                p->animationLastFrame = frame;
+                p->charSpriteIdx = BIRD_SPRITE_DIVING_START;
+            } else if (p->charSpriteIdx < BIRD_SPRITE_DIVING_END && frame - p->animationLastFrame > 2) {
+                p->animationLastFrame = frame;
+                p->charSpriteIdx++;
             }
             // Horizontal speed increases faster while diving
-            if (abs(speedX) < MAX_SPEED_X) {
-                speedX = speedX > 0 ? speedX + 4 : speedX - 4;
+            if (p->speedX < MAX_SPEED_X) {
+                p->speedX += 4;
             }
             // Go back to gliding when DOWN button is released
             if (released & J_DOWN) {
-                charStatus = GLIDING;
+                p->charStatus = GLIDING;
             }
             break;
     }
 
     // Gravity
-    speedY += 1;
-    int16_t maxSpeedY = charStatus == DIVING ? MAX_SPEED_Y_DIVING : MAX_SPEED_Y_GLIDING;
-    if (speedY > maxSpeedY) speedY = maxSpeedY; // Max speed downwards
-    if (speedY < MAX_SPEED_Y_UPWARDS) speedY = MAX_SPEED_Y_UPWARDS; // Max speed upwards
+    p->speedY += 1;
+    if (p->speedY > maxSpeedY[p->charStatus]) p->speedY = maxSpeedY[p->charStatus]; // Max speed downwards
+    if (p->speedY < MAX_SPEED_Y_UPWARDS) p->speedY = MAX_SPEED_Y_UPWARDS; // Max speed upwards
 
     // Move character
-    posX += speedX;
-    posY += speedY;
-    pixelPosX = posX >> 4;
-    pixelPosY = posY >> 4;
-    uint8_t redraw = prevPixelPosX != pixelPosX || prevPixelPosY != pixelPosY;
+    FIXED_STEP_DIR(p->posX, p->speedX, p->movingRight);
+    FIXED_STEP(p->posY, p->speedY);
+    uint8_t redraw = prevPixelPosX != p->posX.pixel || prevPixelPosY != p->posY.pixel;
 
     // Automatic U-turn
-    if (pixelPosX < MIN_POS_X && speedX < 0) {
-        speedX = INITIAL_SPEED_X;
+    if (p->posX.pixel < MIN_POS_X && !p->movingRight) {
+        p->speedX = INITIAL_SPEED_X;
+        p->movingRight = 1;
         redraw = 1;
-    } else if (pixelPosX > MAX_POS_X && speedX > 0) {
-        speedX = -INITIAL_SPEED_X;
+    } else if (p->posX.pixel > MAX_POS_X && p->movingRight) {
+        p->speedX = INITIAL_SPEED_X;
+        p->movingRight = 0;
         redraw = 1;
     }
     // Automatic flapping
-    if (pixelPosY > MAX_POS_Y && speedY > 0 && charStatus != FLAPPING) {
+    if (p->posY.pixel > MAX_POS_Y && p->speedY > 0 && p->charStatus != FLAPPING) {
         // Push upwards
-        speedY += SPEED_Y_BOOST_FLAPPING;
-        charStatus = FLAPPING;
+        p->speedY += SPEED_Y_BOOST_FLAPPING;
+        p->charStatus = FLAPPING;
+        spawnFeather(p);
     }
     // Upper border capping
-    if (pixelPosY < MIN_POS_Y) {
-        posY = MIN_POS_Y << 4;
+    if (p->posY.pixel < MIN_POS_Y) {
+        FIXED_SET(p->posY, MIN_POS_Y);
     }
 
-    // Scroll background
-    if (pixelPosY > 72) {
-        scrollY = pixelPosY - 72;
+    // Scroll background following this player
+    if (p->posY.pixel > 72) {
+        p->scrollY = p->posY.pixel - 72;
     } else {
-        scrollY = 0;
-    }
-    if (scrollY != prevScrollY) {
-        move_bkg(0, scrollY);
+        p->scrollY = 0;
     }
 
+    return redraw;
+}
+
+// Bird metasprite, relative to the displayed background (which follows the local player)
+void drawPlayer(player_t* p, uint8_t firstSprite, uint8_t props) {
+    int16_t y = (int16_t)p->posY.pixel + p->scrollY - scrollY;
     uint8_t hiwater = 0;
-    if (redraw) {
-        switch (speedX > 0) {
-            case 0: hiwater = move_metasprite       (bird_metasprites[charSpriteIdx], BIRD_TILE_NUM_START, BIRD_SPR_NUM_START, pixelPosX, pixelPosY); break;
-            case 1: hiwater = move_metasprite_vflip (bird_metasprites[charSpriteIdx], BIRD_TILE_NUM_START, BIRD_SPR_NUM_START, pixelPosX, pixelPosY); break;
+    // Other player may be far above or below the screen
+    if (y > 0 && y < 168) {
+        switch (p->movingRight) {
+            case 0: hiwater = move_metasprite       (bird_metasprites[p->charSpriteIdx], BIRD_TILE_NUM_START, firstSprite, p->posX.pixel, y); break;
+            case 1: hiwater = move_metasprite_vflip (bird_metasprites[p->charSpriteIdx], BIRD_TILE_NUM_START, firstSprite, p->posX.pixel, y); break;
         };
-        // Hide rest of the hardware sprites, because amount of sprites differs between animation frames. Max sprites used by bird metasprite is 4.
-        for (uint8_t i = hiwater; i < 4; i++) shadow_OAM[BIRD_SPR_NUM_START+i].y = 0;
+        for (uint8_t i = 0; i < hiwater; i++) shadow_OAM[firstSprite+i].prop |= props;
+    }
+    // Hide rest of the hardware sprites, because amount of sprites differs between animation frames. Max sprites used by bird metasprite is 4.
+    for (uint8_t i = hiwater; i < 4; i++) shadow_OAM[firstSprite+i].y = 0;
+}
+
+// First player whose bird touches the food, if any
+player_t* caughtBy(food_t* f) {
+    player_t* p = players;
+    for (uint8_t i = 0; i < playersCount; i++, p++) {
+        // Metasprite origin is the pivot point, food Y needs to account for this player's background scroll
+        if (collideWithBox16(p->posX.pixel - bird_PIVOT_X, p->posY.pixel - bird_PIVOT_Y, f->posX.pixel, (int16_t)f->posY.pixel - p->scrollY, f->kind->spriteHeight << 3)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Handle end of countdown / game
+void endGame() {
+    if (versus) {
+        linkStop();
+        newHiscore = 0;
+    } else {
+        // Saved to cartridge RAM over the next frames
+        newHiscore = submitScore(countdownSetting, players[0].score);
+    }
+    screen = WINNING_SCREEN;    // FIXME Transition
+    initScreen();
+}
+
+
+void gameScreen() {
+    // Poll joypad
+    prevJoypads = joypads;
+    joypad_ex(&joypads);
+    uint8_t pressed = justPressed();
+
+    // Store previous values
+    player_t* local = &players[localPlayer];
+    player_t* other = &players[!localPlayer];
+    uint8_t prevScrollY = scrollY;
+    uint32_t prevScore = local->score;
+    uint32_t prevOtherScore = other->score;
+    uint16_t prevCountdown = countdown;
+
+    // No pause in versus mode, the other console would wait for inputs
+    if (!versus && (pressed & J_START)) {
+        if (paused) {
+            paused = 0;
+            for (int c=0; c<5; c++) {
+                shadow_OAM[PAUSE_SPR_NUM_START + c].y = 0;
+            }
+        } else {
+            paused = 1;
+            for (int c=0; c<5; c++) {
+                set_sprite_tile(PAUSE_SPR_NUM_START + c, PAUSE_TILE_NUM_START + c);
+                move_sprite(PAUSE_SPR_NUM_START + c, 68 + c*8, 84);
+            }
+        }
+    }
+
+    // Show pause
+    if (paused) {
+        return;
+    }
+
+    // Inputs of each player for this frame
+    for (uint8_t i = 0; i < playersCount; i++) {
+        players[i].prevJoy = players[i].joy;
+    }
+    if (versus) {
+        // Local joypad is applied LINK_INPUT_DELAY frames later, on both consoles
+        linkPushInput(joypads.joy0);
+        if (!linkNextInputs(&players[0].joy, &players[1].joy)) {
+            // Other console stopped answering (cable unplugged), game ends with current scores
+            endGame();
+            return;
+        }
+        // Countdown follows simulated frames instead of VBlanks, so that it ends on the same frame on both consoles
+        vblanks++;
+    } else {
+        local->joy = joypads.joy0;
+    }
+
+    // Move players
+    uint8_t redraw = 0;
+    for (uint8_t i = 0; i < playersCount; i++) {
+        if (updatePlayer(&players[i]) && i == localPlayer) {
+            redraw = 1;
+        }
+    }
+
+    scrollY = local->scrollY;
+    // Applied by the raster engine at next VBlank, along with cloud layers
+    setRasterScroll(0, scrollY);
+
+    if (redraw) {
+        drawPlayer(local, BIRD_SPR_NUM_START, 0);
+    }
+    // Other bird also moves on screen when the local one scrolls the background
+    if (versus) {
+        drawPlayer(other, OTHER_BIRD_SPR_NUM_START, OTHER_BIRD_PROPS);
     }
 
     // Spawn food randomly
     int8_t availableSlot = nextAvailableFoodSlot();
     if (availableSlot != -1 && rand() > 120) {
-        food[availableSlot].enabled = 1;
+        food_t *f = &food[availableSlot];
+        f->enabled = 1;
         // Random food type (defines sprite offset, value, speed range, sound fx, ...)
         food_type_t type = (rand() < -110) ? BERRY : DANDELION;    // Around 1 berry every 15 dandelions
-        food[availableSlot].type = type;
-        food[availableSlot].spriteOffset = (type == BERRY) ? 6 : 0;
-        food[availableSlot].spriteCount = (type == BERRY) ? 8 : 3;
-        food[availableSlot].spriteHeight = (type == BERRY) ? 1 : 2;
-        food[availableSlot].spriteIdx = 0;
-        food[availableSlot].animationLastFrame = frame;
+        f->type = type;
+        f->kind = &foodKinds[type];
+        f->spriteIdx = 0;
+        f->animationLastFrame = frame;
         int8_t direction = rand() > 0;
-        food[availableSlot].pixelPosX = (direction > 0) ? 168 : 0;
-        food[availableSlot].posX = food[availableSlot].pixelPosX << 4;
-        food[availableSlot].pixelPosY = (type == BERRY) ? 232 : abs(rand());
-        food[availableSlot].posY = food[availableSlot].pixelPosY << 4;
-        food[availableSlot].speedX = (direction > 0) ? (-1 -(abs(rand()) >> 5)) : (1 + (abs(rand()) >> 5));
-        if (type == BERRY)  food[availableSlot].speedX *= 4;
-        food[availableSlot].speedY = (type == BERRY) ? (-20 -(abs(rand()) >> 3)) : rand() >> 5;
-        food[availableSlot].value = (type == BERRY) ? 100 : 10;
+        FIXED_SET(f->posX, (direction > 0) ? 168 : 0);
+        FIXED_SET(f->posY, (type == BERRY) ? 232 : abs(rand()));
+        f->speedX = (direction > 0) ? (-1 -(abs(rand()) >> 5)) : (1 + (abs(rand()) >> 5));
+        if (type == BERRY)  f->speedX *= 4;
+        f->speedY = (type == BERRY) ? (-20 -(abs(rand()) >> 3)) : rand() >> 5;
         // Play a sound effect on berry appearance
         if (type == BERRY) {
             NR10_REG = 0xb7;    // Channel 1 Sweep: Time 3/128Hz, Freq increases, Shift 7
@@ -678,78 +915,102 @@ void gameScreen() {
         }
     }
 
-    for (int slot=0; slot<MAX_FOOD; slot++) {
-        if (food[slot].enabled != 0) {
+    uint8_t activeFood = 0;
+    food_t *f = food;
+    for (uint8_t slot=0; slot<MAX_FOOD; slot++, f++) {
+        if (f->enabled != 0) {
+            activeFood++;
+            const food_kind_t* kind = f->kind;
             // Speed changes
-            if (food[slot].type == BERRY && !(frame & 0x03)) {
+            if (f->type == BERRY && !(frame & 0x03)) {
                 // Apply gravity
-                food[slot].speedY += 1;
+                f->speedY += 1;
             }
             // Food movements
-            int16_t foodPrevPixelPosX = food[slot].pixelPosX;
-            int16_t foodPrevPixelPosY = food[slot].pixelPosY;
-            food[slot].posX += food[slot].speedX;
-            food[slot].posY += food[slot].speedY;
-            food[slot].pixelPosX = food[slot].posX >> 4;
-            food[slot].pixelPosY = food[slot].posY >> 4;
-            uint8_t moved = foodPrevPixelPosX != food[slot].pixelPosX || foodPrevPixelPosY != food[slot].pixelPosY || (scrollY != prevScrollY);
-
-            // Destroy food when out of screen or caught by the character
-            if (collideWithChar(food[slot].pixelPosX, food[slot].pixelPosY, food[slot].spriteHeight)) {
-                food[slot].enabled = 0;
+            uint8_t foodPrevPixelPosX = f->posX.pixel;
+            uint8_t foodPrevPixelPosY = f->posY.pixel;
+            FIXED_STEP(f->posX, f->speedX);
+            FIXED_STEP(f->posY, f->speedY);
+            uint8_t moved = foodPrevPixelPosX != f->posX.pixel || foodPrevPixelPosY != f->posY.pixel || (scrollY != prevScrollY);
+            // Food sprite top-left in background coordinates
+            uint8_t foodBkgX = f->posX.pixel - 8;
+            uint8_t foodBkgY = f->posY.pixel - 16;
+
+            // Destroy food when out of screen or caught by a player (player 1 first when both reach it)
+            player_t* catcher = caughtBy(f);
+            if (catcher) {
+                f->enabled = 0;
                 shadow_OAM[FOOD_SPR_NUM_START + 2*slot].y = 0;
                 shadow_OAM[FOOD_SPR_NUM_START + 2*slot + 1].y = 0;
                 // Score increases when inputs were not used since many frames
-                uint16_t bonus = ((frame - lastInputFrame) >> 1);
+                uint16_t bonus = ((frame - catcher->lastInputFrame) >> 1);
                 if (bonus > 150)    bonus = 150;    // Bonus is capped at 5 seconds / 150 points
                 if (bonus < 15)     bonus = 0;      // No bonus under a half-second / 15 points
-                score += food[slot].value + bonus;
+                catcher->score += kind->value + bonus;
                 // Play sound effect (emphasized when bonus is >= 50 points)
                 NR10_REG = 0x34 + (bonus >= 50 ? 1 : 0);    // Channel 1 Sweep: Time 3/128Hz, Freq increases, Shift 4
-                NR11_REG = (food[slot].type == BERRY) ? 0x80 : 0x40;    // Channel 1 Wave Pattern and Sound Length: Duty 50% or 25%, Length 1/4 s
+                NR11_REG = (f->type == BERRY) ? 0x80 : 0x40;    // Channel 1 Wave Pattern and Sound Length: Duty 50% or 25%, Length 1/4 s
                 NR12_REG = 0x83 + (bonus >= 50 ? 0x40 : 0);    // Channel 1 Volume Envelope: Initial 8, Volume decreases, Steps 3
                 NR13_REG = 0x00;    // Channel 1 Frequency LSB: (Part of) Freq 1280 Hz
                 NR14_REG = 0xc5 - (bonus >= 50 ? 0x40 : 0);    // Channel 1 Frequency MSB: No Repeat, (Part of) Freq 1280 Hz
+                // Sparkle where the food was caught
+                if (f->posY.pixel >= 16) {
+                    spawnParticle(SPARKLE, foodBkgX + 2, foodBkgY + 2, 0, 0);
+                }
                 continue;
-            } else if ((food[slot].pixelPosX <= 0 && food[slot].speedX < 0)
-                        || (food[slot].pixelPosX >= 168 && food[slot].speedX > 0)
-                        || (food[slot].pixelPosY <= 0 && food[slot].speedY < 0)
-                        || (food[slot].pixelPosY >= 232 && food[slot].speedY > 0)) {   // Max scrollY is 72
-                food[slot].enabled = 0;
+            } else if (((uint8_t)(f->posX.pixel - 1) >= 168 && f->speedX < 0)    // Pixel 0, or wrapped around below 0
+                        || (f->posX.pixel >= 168 && f->speedX > 0)
+                        || ((uint8_t)(f->posY.pixel - 1) >= 232 && f->speedY < 0)
+                        || (f->posY.pixel >= 232 && f->speedY > 0)) {   // Max scrollY is 72
+                f->enabled = 0;
                 shadow_OAM[FOOD_SPR_NUM_START + 2*slot].y = 0;
                 shadow_OAM[FOOD_SPR_NUM_START + 2*slot + 1].y = 0;
                 continue;
             }
 
+            // Berries leave a trail
+            if (f->type == BERRY && !(frame & 0x07) && f->posY.pixel >= 16) {
+                spawnParticle(TRAIL, foodBkgX + 2, foodBkgY + 4, 0, 0);
+            }
+
             // Display and animate food sprites
             uint8_t animated = 0;
-            if (frame - food[slot].animationLastFrame > 15) {
-                food[slot].animationLastFrame = frame;
-                food[slot].spriteIdx++;
-                if (food[slot].spriteIdx >= food[slot].spriteCount) {
-                    food[slot].spriteIdx = 0;
+            if (frame - f->animationLastFrame > 15) {
+                f->animationLastFrame = frame;
+                f->spriteIdx++;
+                if (f->spriteIdx >= kind->spriteCount) {
+                    f->spriteIdx = 0;
                 }
                 animated = 1;
             }
             // Redraw only when required (sprite changed, position changed, scroll changed)
             if (moved || animated) {
                 if (animated) {
-                    for (int s=0; s<food[slot].spriteHeight; s++) {
-                        set_sprite_tile(FOOD_SPR_NUM_START + 2*slot + s, FOOD_TILE_NUM_START + food[slot].spriteOffset + food[slot].spriteIdx*food[slot].spriteHeight + s);
+                    for (uint8_t s=0; s<kind->spriteHeight; s++) {
+                        set_sprite_tile(FOOD_SPR_NUM_START + 2*slot + s, FOOD_TILE_NUM_START + kind->spriteOffset + f->spriteIdx*kind->spriteHeight + s);
                     }
                 }
                 if (moved) {
-                    for (int s=0; s<food[slot].spriteHeight; s++) {
-                        move_sprite(FOOD_SPR_NUM_START + 2*slot + s, food[slot].pixelPosX, food[slot].pixelPosY - scrollY + 8*s);
+                    for (uint8_t s=0; s<kind->spriteHeight; s++) {
+                        move_sprite(FOOD_SPR_NUM_START + 2*slot + s, f->posX.pixel, f->posY.pixel - scrollY + 8*s);
                     }
                 }
             }
         }
     }
 
-    // Print score in window layer
-    if (score != prevScore || score == 0) {
-        printInWindowHeader(scoreTiles, 14, 5, score);
+    if (activeFood > TELEMETRY->foodPeak) {
+        TELEMETRY->foodPeak = activeFood;
+    }
+
+    updateParticles();
+
+    // Print scores in window layer
+    if (local->score != prevScore) {
+        printNumber(TEXT_WIN, 14, 0, local->score, 5);
+    }
+    if (versus && other->score != prevOtherScore) {
+        printNumber(TEXT_WIN, 8, 0, other->score, 5);
     }
 
     // Update countdown
@@ -761,38 +1022,36 @@ void gameScreen() {
             fps = frame - lastVBlankFrame;
             lastVBlankFrame = frame;
         #endif
-        // Handle end of countdown / game
         if (countdown == 0) {
-            screen = WINNING_SCREEN;    // FIXME Transition
-            initScreen();
+            endGame();
             return;
         }
     }
 
     // Print countdown in window layer
-    if (countdown != prevCountdown || countdown == (countdownSetting * 60)) {
-        printInWindowHeader(countdownTiles, 1, 3, countdown);
+    if (countdown != prevCountdown) {
+        printNumber(TEXT_WIN, 1, 0, countdown, 3);
     }
 
     // Show countdown and blink palette 0 during the last 9 seconds
     if (countdown < 10) {
         if (vblanks < 10) {
-            OBP0_REG = 0xE4;
+            queueSpritePalette(0, 0xE4);
         } else if (vblanks < 20) {
-            OBP0_REG = 0x90;
+            queueSpritePalette(0, 0x90);
         } else if (vblanks < 30) {
-            OBP0_REG = 0x40;
+            queueSpritePalette(0, 0x40);
         } else if (vblanks < 40) {
-            OBP0_REG = 0x00;
+            queueSpritePalette(0, 0x00);
         } else if (vblanks < 50) {
-            OBP0_REG = 0x40;
+            queueSpritePalette(0, 0x40);
         } else if (vblanks < 60) {
-            OBP0_REG = 0x90;
+            queueSpritePalette(0, 0x90);
         } else {
-            OBP0_REG = 0xE4;
+            queueSpritePalette(0, 0xE4);
         }
         if (countdown != prevCountdown) {
-            set_sprite_tile(39, sky_tiles_count + countdown);
+            set_sprite_tile(39, FONT_DIGIT_START + countdown);
             if (countdown == 9) {   // Move only once
                 move_sprite(39, 84, 28);
             }
@@ -800,9 +1059,25 @@ void gameScreen() {
     }
 
     #if SHOW_FPS
-        // Print FPS in window layer
-        if (lastVBlankFrame == frame) {
-            printInWindowHeader(fpsTiles, 9, 2, fps);
+        // Print FPS in window layer (where the other player's score is in versus mode)
+        if (!versus && lastVBlankFrame == frame) {
+            printNumber(TEXT_WIN, 9, 0, fps, 2);
+        }
+    #endif
+
+    #if PHYSICS_PROFILE
+        // Print cycles per position step in window layer: current, then former representation (not over the other player's score)
+        profilePhysicsStep(local->posY, local->speedY);
+        if (!versus && !(frame & 0x3F)) {
+            printNumber(TEXT_WIN, 5, 0, physicsStepCost[0], 3);
+            printNumber(TEXT_WIN, 9, 0, physicsStepCost[1], 3);
+        }
+    #endif
+
+    #if RASTER_PROFILE
+        // Print worst LCD interrupt cost (in 16 CPU cycles units) in window layer
+        if (!(frame & 0x3F)) {
+            printNumber(TEXT_WIN, 5, 0, rasterIsrMaxCost, 3);
         }
     #endif
 
@@ -899,24 +1174,119 @@ void winningScreen() {
         return;
     }
 
+    // Blink best score label on a new record
+    if (newHiscore && !(frame & 0x0F)) {
+        if (frame & 0x10) {
+            PRINT_TEXT(TEXT_BKG, 0, 16, best_blank);
+        } else {
+            PRINT_TEXT(TEXT_BKG, 0, 16, best);
+        }
+    }
+
     frame++;
 }
 
 
+// Screens only waiting for a button sleep until the next press
+uint8_t idleAllowed() {
+    // High scores are written to cartridge RAM one chunk per frame
+    if (hiscoresCommitPending()) {
+        return 0;
+    }
+    // Wait for all buttons to be released first: the press waking the CPU up must differ from the last poll,
+    // which becomes prevJoypads (otherwise pressing START again would not unpause)
+    if (joypads.joy0) {
+        return 0;
+    }
+    switch (screen) {
+        case TITLE_SCREEN:
+            return frame >= TITLE_IDLE_AFTER;
+        case GAME_SCREEN:
+            // Versus games never pause, the other console waits for inputs
+            return paused && !versus;
+        case WINNING_SCREEN:
+            // New record label keeps blinking
+            return frame >= 60 && !newHiscore;
+        default:
+            return 0;
+    }
+}
+
+// Halt the CPU until a button is pressed, with the joypad interrupt only: no VBlank or LCD interrupt wakes it up.
+// The LCD keeps showing the current frame with line 0 registers (raster bands freeze), and sound is muted.
+void idleUntilJoypad() {
+    // Master volume 0 is still 1/8 volume: unplug channels from both outputs instead, a held note would drone on.
+    // Music updates NR51 for silences, keep the live value.
+    uint8_t panning = NR51_REG;
+    NR51_REG = 0x00;
+    set_interrupts(JOY_IFLAG);
+    P1_REG = 0x00;      // Select both buttons and directions: any press pulls an input line low
+    while (1) {
+        IF_REG = 0;
+        // A button pressed since the last poll is already low and would not raise the interrupt again.
+        // Also catches contact bounce on release, which may wake the CPU too.
+        if ((P1_REG & 0x0F) != 0x0F) {
+            break;
+        }
+        __asm__("halt");
+        __asm__("nop");
+    }
+    // Flags are raised while sleeping even for disabled interrupts: a stale VBlank would run its handler mid-frame,
+    // counting an extra VBlank and letting the main loop run twice in a frame
+    IF_REG = 0;
+    set_interrupts(GAME_INTERRUPTS);
+    NR51_REG = panning;
+}
+
+
 void vblank_isr() {
-    if (!paused) {
+    uint8_t start = TIMA_REG;
+    rasterVBlank();
+    for (uint8_t i = 0; i < 2; i++) {
+        if (spritePalettesPending[i]) {
+            setSpritePalette(i, spritePalettes[i]);
+        }
+    }
+    // Versus game counts its own frames, see gameScreen
+    if (!paused && !versus) {
         vblanks++;
     }
+    TELEMETRY->vblanks++;
+    uint8_t cost = TIMA_REG - start;
+    if (cost > TELEMETRY->vblankIsrMaxCost) {
+        TELEMETRY->vblankIsrMaxCost = cost;
+    }
 }
 
 
 void main() {
+    // Before anything uses the stack deeply
+    telemetryInit();
+
+    // Detect Game Boy Color and switch to double-speed mode. VBlank-based timings (countdown, music, sound) are unaffected.
+    if (_cpu == CGB_TYPE) {
+        cgbMode = 1;
+        cpu_fast();
+        // Use CGB palette 0 and VRAM bank 0 for the whole background and window maps
+        const uint8_t attributes[32] = { 0 };
+        VBK_REG = 1;
+        for (uint8_t y = 0; y < 32; y++) {
+            set_bkg_tiles(0, y, 32, 1, attributes);
+            set_win_tiles(0, y, 32, 1, attributes);
+        }
+        VBK_REG = 0;
+    }
 
     CRITICAL {
-        STAT_REG = 0x10;    // Enable VBlank interrupt
+        STAT_REG = 0x40;    // LCD interrupt on LY == LYC, for raster effects
         add_VBL(vblank_isr);
+        add_LCD(rasterLcdIsr);
+        add_SIO(linkIsr);
     }
-    set_interrupts(VBL_IFLAG);
+    set_interrupts(GAME_INTERRUPTS);
+
+    // Read high scores from cartridge RAM
+    loadHiscores();
 
     initScreen();
 
@@ -939,8 +1309,38 @@ void main() {
                 break;
         }
 
+        #if OAM_TRACE
+            // Shadow OAM as it will be copied at next VBlank
+            if (screen == GAME_SCREEN) {
+                oam_trace_entry_t* entry = &oamTrace.entries[oamTrace.head];
+                entry->sequence = ++oamTrace.sequence;
+                memcpy(entry->oam, (const void*)shadow_OAM, sizeof(entry->oam));
+                oamTrace.head = (oamTrace.head + 1) % OAM_TRACE_FRAMES;
+            }
+        #endif
+
+        // Prepare raster effects for next frame
+        updateRaster();
+
+        // Save high scores in small chunks, keeping cartridge RAM enabled only briefly
+        commitHiscoresStep();
+
         // Wait for VBlank
         wait_vbl_done();
+        telemetryFrame();
+
+        // Upload particle tiles at the start of VBlank. GBDK's VRAM writes wait for accessible VRAM,
+        // so flushes running past VBlank are only slower.
+        if (screen == GAME_SCREEN) {
+            flushParticles();
+        }
+        // Then text queued during the frame
+        flushText();
+
+        // Sleep right after VBlank work, the next iteration polls the button that woke the CPU up
+        if (idleAllowed()) {
+            idleUntilJoypad();
+        }
     }
 }
 
@@ -0,0 +1,116 @@
+#include <gb/gb.h>
+#include <string.h>
+
+#include "hiscore.h"
+
+// Cartridge RAM holds two copies of the table. A commit always rewrites the older copy, and validates it last,
+// so a power loss during a commit leaves the other copy intact.
+#define HISCORE_MAGIC_0 'H'
+#define HISCORE_MAGIC_1 'S'
+// Bytes written per frame while committing
+#define HISCORE_CHUNK_SIZE 8
+
+typedef struct hiscore_slot_t {
+    uint8_t sequence;       // Incremented on each commit, newest valid copy wins
+    uint32_t scores[HISCORE_DURATIONS];
+    uint16_t checksum;      // Fletcher-16 of sequence and scores
+    uint8_t magic[2];       // Written last: the copy is valid only once the whole payload is in place
+} hiscore_slot_t;
+
+#define HISCORE_SLOTS ((hiscore_slot_t*)0xA000)
+#define HISCORE_PAYLOAD_SIZE (sizeof(hiscore_slot_t) - 2)
+
+hiscore_slot_t hiscores;        // Current table
+uint8_t hiscoresSlot = 1;       // Copy holding the current table
+hiscore_slot_t hiscoresPending; // Image being committed
+uint8_t hiscoresCommitOffset = 0xFF;    // Next payload byte to write, 0xFF when idle
+
+
+uint16_t hiscoresChecksum(const hiscore_slot_t* slot) {
+    const uint8_t* data = (const uint8_t*)slot;
+    uint8_t sum1 = 0, sum2 = 0;
+    for (uint8_t i = 0; i < HISCORE_PAYLOAD_SIZE - 2; i++) {
+        sum1 += *data++;
+        sum2 += sum1;
+    }
+    return ((uint16_t)sum2 << 8) | sum1;
+}
+
+uint8_t hiscoresValid(const hiscore_slot_t* slot) {
+    return slot->magic[0] == HISCORE_MAGIC_0 && slot->magic[1] == HISCORE_MAGIC_1 && slot->checksum == hiscoresChecksum(slot);
+}
+
+void loadHiscores() {
+    hiscore_slot_t copies[2];
+    // Cartridge RAM is enabled only for the copy
+    ENABLE_RAM_MBC1;
+    SWITCH_RAM_MBC1(0);
+    memcpy(copies, HISCORE_SLOTS, sizeof(copies));
+    DISABLE_RAM_MBC1;
+
+    uint8_t valid0 = hiscoresValid(&copies[0]);
+    uint8_t valid1 = hiscoresValid(&copies[1]);
+    if (valid0 && (!valid1 || (int8_t)(copies[0].sequence - copies[1].sequence) > 0)) {
+        hiscoresSlot = 0;
+    } else if (valid1) {
+        hiscoresSlot = 1;
+    } else {
+        // Blank or corrupted cartridge RAM: next commit goes to the first copy
+        memset(&copies[1], 0, sizeof(hiscore_slot_t));
+        hiscoresSlot = 1;
+    }
+    memcpy(&hiscores, &copies[hiscoresSlot], sizeof(hiscore_slot_t));
+}
+
+uint32_t getHiscore(uint8_t duration) {
+    return hiscores.scores[duration - 1];
+}
+
+uint8_t submitScore(uint8_t duration, uint32_t score) {
+    if (score <= hiscores.scores[duration - 1]) {
+        return 0;
+    }
+    hiscores.scores[duration - 1] = score;
+    // Restarts any commit in progress, which still targets the older copy
+    hiscores.sequence++;
+    hiscores.checksum = hiscoresChecksum(&hiscores);
+    hiscores.magic[0] = HISCORE_MAGIC_0;
+    hiscores.magic[1] = HISCORE_MAGIC_1;
+    memcpy(&hiscoresPending, &hiscores, sizeof(hiscore_slot_t));
+    hiscoresCommitOffset = 0;
+    return 1;
+}
+
+uint8_t hiscoresCommitPending() {
+    return hiscoresCommitOffset != 0xFF;
+}
+
+void commitHiscoresStep() {
+    if (hiscoresCommitOffset == 0xFF) {
+        return;
+    }
+    uint8_t target = hiscoresSlot ^ 1;
+    uint8_t* dst = (uint8_t*)&HISCORE_SLOTS[target];
+    const uint8_t* src = (const uint8_t*)&hiscoresPending;
+    uint8_t offset = hiscoresCommitOffset;
+
+    ENABLE_RAM_MBC1;
+    if (offset == 0) {
+        // Invalidate the target copy before touching its payload
+        dst[HISCORE_PAYLOAD_SIZE] = 0;
+    }
+    if (offset < HISCORE_PAYLOAD_SIZE) {
+        uint8_t count = HISCORE_PAYLOAD_SIZE - offset;
+        if (count > HISCORE_CHUNK_SIZE)     count = HISCORE_CHUNK_SIZE;
+        memcpy(dst + offset, src + offset, count);
+        offset += count;
+    } else {
+        // Whole payload written: validate the copy
+        dst[HISCORE_PAYLOAD_SIZE + 1] = HISCORE_MAGIC_1;
+        dst[HISCORE_PAYLOAD_SIZE] = HISCORE_MAGIC_0;
+        hiscoresSlot = target;
+        offset = 0xFF;
+    }
+    DISABLE_RAM_MBC1;
+    hiscoresCommitOffset = offset;
+}
@@ -0,0 +1,18 @@
+#ifndef HISCORE_H
+#define HISCORE_H
+
+#include <gb/gb.h>
+
+// One high score per game duration setting (1 to 9 minutes)
+#define HISCORE_DURATIONS 9
+
+// Single validated read of cartridge RAM, at boot
+void loadHiscores();
+uint32_t getHiscore(uint8_t duration);
+// Returns 1 for a new record, which is then committed to cartridge RAM over the next frames
+uint8_t submitScore(uint8_t duration, uint32_t score);
+// Write the next chunk of a pending commit (once per frame)
+void commitHiscoresStep();
+uint8_t hiscoresCommitPending();
+
+#endif
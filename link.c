@@ -0,0 +1,210 @@
+#include <gb/gb.h>
+
+#include "link.h"
+#include "hiscore.h"
+
+// Serial control register values
+#define SERIAL_LISTEN 0x80      // Transfer requested, external clock
+#define SERIAL_TRANSFER 0x81    // Transfer started, internal clock (8192 Hz, 16384 Hz in CGB double-speed mode)
+
+// An unarmed slave doesn't shift anything, and the master reads the idle line: no byte was exchanged.
+// It can't be a valid input, LEFT and RIGHT are never sent together.
+#define LINK_NOT_READY 0xFF
+// Handshake: the host sends HELLO, seed LSB, seed MSB and duration setting, each byte is answered with READY.
+// HELLO always starts a new handshake (a host may cancel and host again), so it never appears in the other bytes.
+#define LINK_HELLO 0x5A
+#define LINK_READY 0xA5
+#define HANDSHAKE_SIZE 4
+
+// Inputs by frame number, modulo ring size. At most LINK_INPUT_DELAY + 1 local inputs are in flight.
+#define LINK_RING_SIZE 8
+#if LINK_INPUT_DELAY < 1 || LINK_INPUT_DELAY > LINK_RING_SIZE - 2
+    #error "LINK_INPUT_DELAY must be between 1 and LINK_RING_SIZE - 2"
+#endif
+
+typedef enum link_state_t {
+    LINK_IDLE,
+    LINK_LISTENING,
+    LINK_HOSTING,
+    LINK_JOINED,    // Handshake done, until the game starts
+    LINK_PLAYING
+} link_state_t;
+
+link_role_t linkRole = LINK_OFF;
+uint16_t linkSeed = 0;
+uint8_t linkSetting = 0;
+
+volatile link_state_t linkState = LINK_IDLE;
+volatile uint8_t linkBusy = 0;          // A transfer is running (master) or armed (slave)
+volatile uint8_t handshakeIndex = 0;
+uint8_t handshake[HANDSHAKE_SIZE];
+
+uint8_t localInputs[LINK_RING_SIZE];
+volatile uint8_t remoteInputs[LINK_RING_SIZE];
+uint8_t linkFrame;                  // Next frame to simulate
+uint8_t linkCaptured;               // Next frame to push a local input for
+volatile uint8_t linkExchanged;     // Next frame to exchange inputs for
+
+
+void linkIsr() {
+    uint8_t data = SB_REG;
+    switch (linkState) {
+        case LINK_LISTENING:
+            // Bytes before HELLO are ignored
+            if (data == LINK_HELLO) {
+                handshakeIndex = 0;
+            }
+            if (handshakeIndex != 0 || data == LINK_HELLO) {
+                handshake[handshakeIndex++] = data;
+            }
+            // Duration setting indexes high scores: anything else is garbage, wait for the next HELLO
+            if (handshakeIndex == HANDSHAKE_SIZE && (handshake[3] < 1 || handshake[3] > HISCORE_DURATIONS)) {
+                handshakeIndex = 0;
+            }
+            if (handshakeIndex == HANDSHAKE_SIZE) {
+                linkSeed = handshake[1] | ((uint16_t)handshake[2] << 8);
+                linkSetting = handshake[3];
+                linkRole = LINK_SLAVE;
+                linkState = LINK_JOINED;
+            } else {
+                SB_REG = LINK_READY;
+                SC_REG = SERIAL_LISTEN;
+            }
+            break;
+        case LINK_HOSTING:
+            linkBusy = 0;
+            // Otherwise, the same byte is sent again on next pump
+            if (data == LINK_READY && ++handshakeIndex == HANDSHAKE_SIZE) {
+                linkRole = LINK_MASTER;
+                linkState = LINK_JOINED;
+            }
+            break;
+        case LINK_PLAYING:
+            linkBusy = 0;
+            if (linkRole == LINK_MASTER && data == LINK_NOT_READY) {
+                break;
+            }
+            remoteInputs[linkExchanged % LINK_RING_SIZE] = data;
+            linkExchanged++;
+            // The slave arms the next input right away, if it's already known
+            if (linkRole == LINK_SLAVE && linkExchanged != linkCaptured) {
+                SB_REG = localInputs[linkExchanged % LINK_RING_SIZE];
+                SC_REG = SERIAL_LISTEN;
+                linkBusy = 1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void linkListen() {
+    CRITICAL {
+        linkRole = LINK_OFF;
+        linkState = LINK_LISTENING;
+        handshakeIndex = 0;
+        SB_REG = LINK_READY;
+        SC_REG = SERIAL_LISTEN;
+    }
+}
+
+void linkHost(uint16_t seed, uint8_t setting) {
+    if ((seed & 0xFF) == LINK_HELLO) {
+        seed ^= 0x0001;
+    }
+    if ((seed >> 8) == LINK_HELLO) {
+        seed ^= 0x0100;
+    }
+    CRITICAL {
+        SC_REG = 0;
+        handshake[0] = LINK_HELLO;
+        handshake[1] = seed & 0xFF;
+        handshake[2] = seed >> 8;
+        handshake[3] = setting;
+        linkSeed = seed;
+        linkSetting = setting;
+        handshakeIndex = 0;
+        linkBusy = 0;
+        linkState = LINK_HOSTING;
+    }
+}
+
+uint8_t linkHosting() {
+    return linkState == LINK_HOSTING;
+}
+
+uint8_t linkReady() {
+    return linkState == LINK_JOINED;
+}
+
+void linkStop() {
+    CRITICAL {
+        SC_REG = 0;
+        linkState = LINK_IDLE;
+        linkBusy = 0;
+    }
+}
+
+void linkPump() {
+    CRITICAL {
+        if (!linkBusy) {
+            if (linkState == LINK_HOSTING) {
+                SB_REG = handshake[handshakeIndex];
+                SC_REG = SERIAL_TRANSFER;
+                linkBusy = 1;
+            } else if (linkState == LINK_PLAYING && linkExchanged != linkCaptured) {
+                SB_REG = localInputs[linkExchanged % LINK_RING_SIZE];
+                SC_REG = (linkRole == LINK_MASTER) ? SERIAL_TRANSFER : SERIAL_LISTEN;
+                linkBusy = 1;
+            }
+        }
+    }
+}
+
+void linkStartGame() {
+    // First frames are played without input on both consoles
+    for (uint8_t i = 0; i < LINK_RING_SIZE; i++) {
+        localInputs[i] = 0;
+        remoteInputs[i] = 0;
+    }
+    CRITICAL {
+        SC_REG = 0;
+        linkFrame = 0;
+        linkCaptured = LINK_INPUT_DELAY;
+        linkExchanged = LINK_INPUT_DELAY;
+        linkBusy = 0;
+        linkState = LINK_PLAYING;
+    }
+}
+
+void linkPushInput(uint8_t joy) {
+    if ((joy & (J_LEFT | J_RIGHT)) == (J_LEFT | J_RIGHT)) {
+        joy &= ~(J_LEFT | J_RIGHT);
+    }
+    localInputs[linkCaptured % LINK_RING_SIZE] = joy;
+    linkCaptured++;
+    linkPump();
+}
+
+uint8_t linkNextInputs(uint8_t* masterJoy, uint8_t* slaveJoy) {
+    // Inputs for this frame were sent LINK_INPUT_DELAY frames ago, so this only waits for a lagging console
+    uint16_t start = sys_time;
+    while ((int8_t)(linkExchanged - linkFrame) <= 0) {
+        if (linkState != LINK_PLAYING || (uint16_t)(sys_time - start) > LINK_TIMEOUT) {
+            linkStop();
+            return 0;
+        }
+        // Retry after LINK_NOT_READY
+        linkPump();
+    }
+    uint8_t i = linkFrame % LINK_RING_SIZE;
+    if (linkRole == LINK_MASTER) {
+        *masterJoy = localInputs[i];
+        *slaveJoy = remoteInputs[i];
+    } else {
+        *masterJoy = remoteInputs[i];
+        *slaveJoy = localInputs[i];
+    }
+    linkFrame++;
+    return 1;
+}
@@ -0,0 +1,42 @@
+#ifndef LINK_H
+#define LINK_H
+
+#include <gb/gb.h>
+
+// Frames between reading the joypad and applying it, so that each input byte has a whole frame to cross the cable
+#define LINK_INPUT_DELAY 2
+// VBlanks spent waiting for the other console before giving up (unplugged cable)
+#define LINK_TIMEOUT 120
+
+typedef enum link_role_t {
+    LINK_OFF,
+    LINK_MASTER,    // Hosted the game, clocks the transfers, player 1
+    LINK_SLAVE      // Joined the game, player 2
+} link_role_t;
+
+extern link_role_t linkRole;
+// Agreed during the handshake
+extern uint16_t linkSeed;
+extern uint8_t linkSetting;
+
+// Serial interrupt handler
+void linkIsr();
+// Wait for a host, answering its handshake from the serial interrupt
+void linkListen();
+// Send the handshake to a listening console, one byte per frame (see linkPump)
+void linkHost(uint16_t seed, uint8_t setting);
+uint8_t linkHosting();
+// Handshake done, both consoles can start the game
+uint8_t linkReady();
+// Release the serial port
+void linkStop();
+// Start or retry the pending transfer (once per frame while hosting, automatically while playing)
+void linkPump();
+
+// Lockstep: each frame, push the local joypad, then get the inputs of both players for the current frame.
+// Returns 0 when the other console stopped answering.
+void linkStartGame();
+void linkPushInput(uint8_t joy);
+uint8_t linkNextInputs(uint8_t* masterJoy, uint8_t* slaveJoy);
+
+#endif
@@ -0,0 +1,194 @@
+#include <gb/gb.h>
+
+#include "particles.h"
+#include "physics.h"
+
+#include "tilesets/particles_tiles.h"
+
+// Particle glyphs are drawn in the top-left 4x4 pixels of each particles tile, color 0 is transparent
+#define GLYPH_SIZE 4
+// Maximum number of reserved tiles uploaded per VBlank, remaining ones are deferred to the next frame
+#define PARTICLE_FLUSH_BUDGET 3
+
+typedef struct particle_kind_t {
+    uint8_t firstFrame;
+    uint8_t frameCount;
+    uint8_t frameDuration;
+    uint8_t lifetime;
+} particle_kind_t;
+const particle_kind_t particleKinds[] = {
+    { .firstFrame=0, .frameCount=2, .frameDuration=8, .lifetime=48 },  // FEATHER
+    { .firstFrame=2, .frameCount=3, .frameDuration=4, .lifetime=12 },  // SPARKLE
+    { .firstFrame=5, .frameCount=2, .frameDuration=6, .lifetime=12 }   // TRAIL
+};
+
+typedef struct particle_t {
+    uint8_t enabled;
+    const particle_kind_t* kind;
+    uint8_t age;
+    uint8_t frame;
+    uint8_t frameTimer;
+    fixed_t posX, posY;
+    int8_t speedX, speedY;
+    uint8_t mapX, mapY;         // Background map cell covered by the particle
+    uint8_t dirty;              // Tile pixels changed since last upload
+    uint8_t shown;              // Map cell (shownX, shownY) points to the reserved tile in VRAM
+    uint8_t shownX, shownY;
+    uint8_t tile[16];           // Reserved tile pixels: background tile with the glyph drawn over it
+} particle_t;
+particle_t particles[PARTICLE_POOL_SIZE];
+
+uint8_t particleFirstTile;
+const uint8_t* particleBkgTiles;
+const uint8_t* particleBkgMap;
+uint8_t particleMapWidth, particleMapHeight;
+
+
+void initParticles(uint8_t firstTile, const uint8_t* bkgTiles, const uint8_t* bkgMap, uint8_t mapWidth, uint8_t mapHeight) {
+    particleFirstTile = firstTile;
+    particleBkgTiles = bkgTiles;
+    particleBkgMap = bkgMap;
+    particleMapWidth = mapWidth;
+    particleMapHeight = mapHeight;
+    for (uint8_t i = 0; i < PARTICLE_POOL_SIZE; i++) {
+        particles[i].enabled = 0;
+        particles[i].shown = 0;
+    }
+}
+
+const uint8_t* bkgMapCell(uint8_t mapX, uint8_t mapY) {
+    return particleBkgMap + (uint16_t)mapY * particleMapWidth + mapX;
+}
+
+// A cell is taken when another particle covers it, or still shows its reserved tile there
+uint8_t cellTaken(particle_t* self, uint8_t mapX, uint8_t mapY) {
+    particle_t* p = particles;
+    for (uint8_t i = 0; i < PARTICLE_POOL_SIZE; i++, p++) {
+        if (p == self) continue;
+        if (p->enabled && p->mapX == mapX && p->mapY == mapY) return 1;
+        if (p->shown && p->shownX == mapX && p->shownY == mapY) return 1;
+    }
+    return 0;
+}
+
+// Draw the current glyph over the background tile, clipped to the cell
+void composeParticle(particle_t* p) {
+    const uint8_t* bkg = particleBkgTiles + ((uint16_t)*bkgMapCell(p->mapX, p->mapY) << 4);
+    const uint8_t* glyph = particles_tiles + ((uint16_t)(p->kind->firstFrame + p->frame) << 4);
+    uint8_t offsetX = p->posX.pixel & 0x07;
+    uint8_t offsetY = p->posY.pixel & 0x07;
+    uint8_t* out = p->tile;
+    for (uint8_t row = 0; row < 8; row++) {
+        uint8_t low = 0, high = 0;
+        uint8_t glyphRow = row - offsetY;
+        if (glyphRow < GLYPH_SIZE) {
+            low = glyph[glyphRow << 1] >> offsetX;
+            high = glyph[(glyphRow << 1) + 1] >> offsetX;
+        }
+        uint8_t mask = ~(low | high);
+        *out++ = (*bkg++ & mask) | low;
+        *out++ = (*bkg++ & mask) | high;
+    }
+    p->dirty = 1;
+}
+
+void spawnParticle(particle_type_t type, uint8_t x, uint8_t y, int8_t speedX, int8_t speedY) {
+    if (x >= (particleMapWidth << 3))   return;
+    uint8_t mapX = x >> 3;
+    uint8_t mapY = y >> 3;
+    if (mapY >= particleMapHeight || cellTaken(0, mapX, mapY))  return;
+    particle_t* p = particles;
+    for (uint8_t i = 0; i < PARTICLE_POOL_SIZE; i++, p++) {
+        // Released particles are reused once their cell has been restored
+        if (!p->enabled && !p->shown) {
+            p->enabled = 1;
+            p->kind = &particleKinds[type];
+            p->age = 0;
+            p->frame = 0;
+            p->frameTimer = p->kind->frameDuration;
+            FIXED_SET(p->posX, x);
+            FIXED_SET(p->posY, y);
+            p->speedX = speedX;
+            p->speedY = speedY;
+            p->mapX = mapX;
+            p->mapY = mapY;
+            composeParticle(p);
+            return;
+        }
+    }
+}
+
+void updateParticles() {
+    particle_t* p = particles;
+    for (uint8_t i = 0; i < PARTICLE_POOL_SIZE; i++, p++) {
+        if (!p->enabled)    continue;
+        if (++p->age >= p->kind->lifetime) {
+            p->enabled = 0;     // Cell is restored on next flush
+            continue;
+        }
+        uint8_t changed = 0;
+        if (--p->frameTimer == 0) {
+            p->frameTimer = p->kind->frameDuration;
+            p->frame++;
+            if (p->frame >= p->kind->frameCount) {
+                p->frame = 0;
+            }
+            changed = 1;
+        }
+        uint8_t prevPixelPosX = p->posX.pixel;
+        uint8_t prevPixelPosY = p->posY.pixel;
+        FIXED_STEP(p->posX, p->speedX);
+        FIXED_STEP(p->posY, p->speedY);
+        if (p->posX.pixel != prevPixelPosX || p->posY.pixel != prevPixelPosY) {
+            if (p->posX.pixel >= (particleMapWidth << 3)) {
+                p->enabled = 0;
+                continue;
+            }
+            uint8_t mapX = p->posX.pixel >> 3;
+            uint8_t mapY = p->posY.pixel >> 3;
+            if (mapX != p->mapX || mapY != p->mapY) {
+                // Particles never share a cell
+                if (mapY >= particleMapHeight || cellTaken(p, mapX, mapY)) {
+                    p->enabled = 0;
+                    continue;
+                }
+                p->mapX = mapX;
+                p->mapY = mapY;
+            }
+            changed = 1;
+        }
+        if (changed) {
+            composeParticle(p);
+        }
+    }
+}
+
+void flushParticles() {
+    uint8_t budget = PARTICLE_FLUSH_BUDGET;
+    particle_t* p = particles;
+    for (uint8_t i = 0; i < PARTICLE_POOL_SIZE; i++, p++) {
+        if (!p->enabled) {
+            // Restore background under released particles
+            if (p->shown) {
+                set_bkg_tiles(p->shownX, p->shownY, 1, 1, bkgMapCell(p->shownX, p->shownY));
+                p->shown = 0;
+            }
+        } else if (p->dirty && budget) {
+            budget--;
+            // A moved particle leaves its previous cell only once its new tile is uploaded
+            if (p->shown && (p->shownX != p->mapX || p->shownY != p->mapY)) {
+                set_bkg_tiles(p->shownX, p->shownY, 1, 1, bkgMapCell(p->shownX, p->shownY));
+                p->shown = 0;
+            }
+            uint8_t tile = particleFirstTile + i;
+            set_bkg_data(tile, 1, p->tile);
+            if (!p->shown) {
+                set_bkg_tiles(p->mapX, p->mapY, 1, 1, &tile);
+                p->shown = 1;
+                p->shownX = p->mapX;
+                p->shownY = p->mapY;
+            }
+            p->dirty = 0;
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <gb/gb.h>
+
+// Particles are drawn into reserved background tiles (one per pool slot), so they don't use any hardware sprite
+#define PARTICLE_POOL_SIZE 6
+
+typedef enum particle_type_t {
+    FEATHER,
+    SPARKLE,
+    TRAIL
+} particle_type_t;
+
+// Reset the pool for a new background: particles are composed over bkgTiles, and bkgMap is used to restore map cells
+void initParticles(uint8_t firstTile, const uint8_t* bkgTiles, const uint8_t* bkgMap, uint8_t mapWidth, uint8_t mapHeight);
+// Position is in background pixels (top-left of the particle), speeds in 1/16th of pixel per frame. Silently dropped when the pool is full.
+void spawnParticle(particle_type_t type, uint8_t x, uint8_t y, int8_t speedX, int8_t speedY);
+// Animate, move and compose particles (once per frame)
+void updateParticles();
+// Upload pending tiles and map cells (right after VBlank)
+void flushParticles();
+
+#endif
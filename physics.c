@@ -0,0 +1,52 @@
+#include <gb/gb.h>
+
+#include "physics.h"
+
+// Overlap between a 16x16 box and an 8 pixels wide sprite column of spriteHeight pixels.
+// Both ranges are checked with a single unsigned comparison: (d + size - 1) wraps around when d is out of the band.
+uint8_t collideWithBox16(uint8_t boxX, uint8_t boxY, uint8_t spriteX, int16_t spriteY, uint8_t spriteHeight) {
+    // Early reject on the Y band, which discards most food. Sprite Y may be off-screen (negative) because of background scroll.
+    if ((uint16_t)(spriteY - boxY + spriteHeight - 1) >= (uint16_t)(16 + spriteHeight - 1)) {
+        return 0;
+    }
+    // X distance always fits in 8 bits: food spans 0..168 and the box never goes below 0
+    return (uint8_t)(spriteX - boxX + 7) < (16 + 8 - 1);
+}
+
+#if PHYSICS_PROFILE
+    // Steps per measurement: with a timer tick every 16 CPU cycles, ticks of a batch are cycles per step
+    #define PROFILE_STEPS 16
+
+    uint8_t physicsStepCost[2];
+    volatile uint8_t profileSink;
+
+    void profilePhysicsStep(fixed_t pos, int8_t speed) {
+        int16_t legacyPos = ((int16_t)pos.pixel << 4) | pos.sub;
+        int16_t legacySpeed = speed;
+        uint8_t empty, fixedCost, legacyCost;
+        // Timer runs at 262144 Hz, see telemetryInit. Interrupts would add to the measurements.
+        CRITICAL {
+            uint8_t start = TIMA_REG;
+            for (uint8_t i = 0; i < PROFILE_STEPS; i++) {
+                profileSink = i;
+            }
+            empty = TIMA_REG - start;
+
+            start = TIMA_REG;
+            for (uint8_t i = 0; i < PROFILE_STEPS; i++) {
+                FIXED_STEP(pos, speed);
+                profileSink = pos.pixel;
+            }
+            fixedCost = TIMA_REG - start;
+
+            start = TIMA_REG;
+            for (uint8_t i = 0; i < PROFILE_STEPS; i++) {
+                legacyPos += legacySpeed;
+                profileSink = legacyPos >> 4;
+            }
+            legacyCost = TIMA_REG - start;
+        }
+        physicsStepCost[0] = fixedCost - empty;
+        physicsStepCost[1] = legacyCost - empty;
+    }
+#endif
@@ -0,0 +1,36 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <gb/gb.h>
+
+// Time the position step against the former one (12.4 fixed point in an int16_t: 16-bit add, then >> 4 for the pixel)
+// with the timer, into physicsStepCost
+#define PHYSICS_PROFILE 0
+
+// Positions are 12.4 fixed point, stored as an 8-bit pixel part and a 4-bit sub-pixel remainder.
+// Every coordinate used by the game (sprites, food spawn lines, scroll) fits in 0..255, so the whole
+// integration is done with 8-bit adds instead of 16-bit adds and shifts.
+typedef struct fixed_t {
+    uint8_t pixel;
+    int8_t sub;     // Sub-pixel remainder, always within [0, 15] between steps
+} fixed_t;
+
+// Place a position on a pixel boundary
+#define FIXED_SET(pos, px) do { (pos).pixel = (px); (pos).sub = 0; } while (0)
+
+// Advance a position by a signed speed, in 1/16th of pixel per frame (must stay within [-112, 112])
+#define FIXED_STEP(pos, speed) do { (pos).sub += (speed); (pos).pixel += (int8_t)(pos).sub >> 4; (pos).sub &= 0x0F; } while (0)
+
+// Advance a position by a speed stored as magnitude and direction
+#define FIXED_STEP_DIR(pos, magnitude, positive) do { if (positive) (pos).sub += (magnitude); else (pos).sub -= (magnitude); (pos).pixel += (int8_t)(pos).sub >> 4; (pos).sub &= 0x0F; } while (0)
+
+uint8_t collideWithBox16(uint8_t boxX, uint8_t boxY, uint8_t spriteX, int16_t spriteY, uint8_t spriteHeight);
+
+#if PHYSICS_PROFILE
+    // CPU cycles of one position step, loop overhead excluded: [0] FIXED_STEP, [1] former 16-bit step
+    extern uint8_t physicsStepCost[2];
+    // Steps a copy of the position with both representations, the caller's entity is left untouched
+    void profilePhysicsStep(fixed_t pos, int8_t speed);
+#endif
+
+#endif
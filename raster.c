@@ -0,0 +1,197 @@
+#include <gb/gb.h>
+
+#include "raster.h"
+#include "telemetry.h"
+
+#if RASTER_MAX_BANDS != TELEMETRY_RASTER_BANDS
+    #error "TELEMETRY_RASTER_BANDS in telemetry.h does not match RASTER_MAX_BANDS"
+#endif
+
+// Sentinel line, never reached by LY (0-153)
+#define RASTER_END 0xFF
+
+typedef struct raster_band_t {
+    uint8_t line;   // First scanline using these values
+    uint8_t scx, scy, bgp;
+} raster_band_t;
+
+// Heat shimmer: horizontal offsets for the title logo, two periods over 64 phases
+const int8_t shimmerTable[64] = {
+    0, 0, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 0,
+    0, 0, -1, -1, -1, -2, -2, -2, -2, -2, -2, -2, -1, -1, -1, 0,
+    0, 0, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 0,
+    0, 0, -1, -1, -1, -2, -2, -2, -2, -2, -2, -2, -1, -1, -1, 0
+};
+#define SHIMMER_FIRST_LINE 8
+#define SHIMMER_BAND_HEIGHT 4
+#define SHIMMER_BANDS 12
+
+// Cloud layers: top of each layer in sky map pixels, and horizontal sway per phase (amplitude grows with nearness)
+#define CLOUD_LAYERS 4
+const uint8_t cloudLayerTops[CLOUD_LAYERS] = { 96, 128, 168, 208 };
+const int8_t cloudSwayTable[CLOUD_LAYERS][64] = {
+    {
+        0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0
+    },
+    {
+        2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 0, 0,
+        0, 0, 0, -1, -1, -1, -1, -1, -1, -2, -2, -2, -2, -2, -2, -2,
+        -2, -2, -2, -2, -2, -2, -2, -2, -1, -1, -1, -1, -1, -1, 0, 0,
+        0, 0, 0, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2
+    },
+    {
+        0, 0, -1, -1, -1, -1, -2, -2, -2, -2, -2, -3, -3, -3, -3, -3,
+        -3, -3, -3, -3, -3, -3, -2, -2, -2, -2, -2, -1, -1, -1, -1, 0,
+        0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3,
+        3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 1, 1, 1, 1, 0
+    },
+    {
+        -4, -4, -4, -4, -4, -4, -3, -3, -3, -3, -2, -2, -2, -1, -1, 0,
+        0, 0, 1, 1, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4,
+        4, 4, 4, 4, 4, 4, 3, 3, 3, 3, 2, 2, 2, 1, 1, 0,
+        0, 0, -1, -1, -2, -2, -2, -3, -3, -3, -3, -4, -4, -4, -4, -4
+    }
+};
+
+raster_effect_t rasterEffect = RASTER_NONE;
+uint8_t rasterBaseX = 0, rasterBaseY = 0;
+uint8_t rasterPhase = 0;
+
+// Double-buffered band lists: the main loop fills the back buffer, the VBlank interrupt swaps it in
+raster_band_t rasterBands[2][RASTER_MAX_BANDS + 2];     // Line 0 values, bands, terminator
+uint8_t rasterBack = 0;
+volatile uint8_t rasterReady = 0;
+const raster_band_t* rasterFront = rasterBands[1];
+const raster_band_t* rasterNext = rasterBands[1];
+
+#if RASTER_PROFILE
+    uint8_t rasterIsrMaxCost = 0;
+    uint8_t rasterBandIdx = 0;
+#endif
+
+
+// Called while the display is off: bands for the first frame are prepared right away
+void setRasterEffect(raster_effect_t effect) {
+    rasterEffect = effect;
+    rasterPhase = 0;
+    rasterReady = 0;
+    updateRaster();
+    #if RASTER_PROFILE
+        TAC_REG = 0x05;     // Timer enabled, 262144 Hz: one tick every 16 CPU cycles (in both CPU speeds)
+    #endif
+}
+
+void setRasterScroll(uint8_t x, uint8_t y) {
+    rasterBaseX = x;
+    rasterBaseY = y;
+}
+
+void updateRaster() {
+    // Previous list wasn't consumed yet
+    if (rasterReady) {
+        return;
+    }
+    raster_band_t* band = rasterBands[rasterBack];
+    uint8_t bgp = BGP_REG;
+
+    // Line 0
+    band->line = 0;
+    band->scx = rasterBaseX;
+    band->scy = rasterBaseY;
+    band->bgp = bgp;
+    band++;
+
+    switch (rasterEffect) {
+        case RASTER_NONE:
+            break;
+        case RASTER_TITLE_SHIMMER: {
+            uint8_t phase = rasterPhase;
+            uint8_t line = SHIMMER_FIRST_LINE;
+            for (uint8_t b = 0; b < SHIMMER_BANDS; b++, band++, line += SHIMMER_BAND_HEIGHT, phase += 5) {
+                band->line = line;
+                band->scx = rasterBaseX + shimmerTable[phase & 63];
+                band->scy = rasterBaseY;
+                band->bgp = bgp;
+            }
+            // Back to base values below the logo
+            band->line = line;
+            band->scx = rasterBaseX;
+            band->scy = rasterBaseY;
+            band->bgp = bgp;
+            band++;
+            rasterPhase++;
+            break;
+        }
+        case RASTER_SKY_CLOUDS: {
+            // Layers are anchored to the sky map, so they follow the vertical scroll
+            uint8_t phase = (rasterPhase >> 2) & 63;
+            for (uint8_t l = 0; l < CLOUD_LAYERS; l++) {
+                uint8_t line = cloudLayerTops[l] - rasterBaseY;
+                if (line >= 144) {
+                    break;
+                }
+                band->line = line;
+                band->scx = rasterBaseX + cloudSwayTable[l][phase];
+                band->scy = rasterBaseY;
+                band->bgp = bgp;
+                band++;
+            }
+            rasterPhase++;
+            break;
+        }
+    }
+
+    band->line = RASTER_END;
+    rasterReady = 1;
+}
+
+void rasterVBlank() {
+    if (rasterReady) {
+        rasterFront = rasterBands[rasterBack];
+        rasterBack ^= 1;
+        rasterReady = 0;
+    }
+    const raster_band_t* band = rasterFront;
+    SCX_REG = band->scx;
+    SCY_REG = band->scy;
+    BGP_REG = band->bgp;
+    band++;
+    rasterNext = band;
+    // Interrupt on the line before the band, registers are written during its HBlank
+    LYC_REG = band->line - 1;
+    #if RASTER_PROFILE
+        rasterBandIdx = 0;
+    #endif
+}
+
+// Cost is bounded: one band per interrupt, and at most one scanline spent waiting for HBlank
+void rasterLcdIsr() {
+    #if RASTER_PROFILE
+        uint8_t start = TIMA_REG;
+    #endif
+    const raster_band_t* band = rasterNext;
+    if (band->line == RASTER_END) {
+        return;
+    }
+    // Wait for HBlank (mode 0)
+    while (STAT_REG & 0x03);
+    SCX_REG = band->scx;
+    SCY_REG = band->scy;
+    BGP_REG = band->bgp;
+    band++;
+    rasterNext = band;
+    LYC_REG = band->line - 1;
+    #if RASTER_PROFILE
+        uint8_t cost = TIMA_REG - start;
+        if (cost > TELEMETRY->rasterIsrMaxCost[rasterBandIdx]) {
+            TELEMETRY->rasterIsrMaxCost[rasterBandIdx] = cost;
+        }
+        if (cost > rasterIsrMaxCost) {
+            rasterIsrMaxCost = cost;
+        }
+        rasterBandIdx++;
+    #endif
+}
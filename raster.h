@@ -0,0 +1,32 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <gb/gb.h>
+
+// Measure the LCD interrupt handler with the timer (in units of 16 CPU cycles): worst of each band in the telemetry block
+#define RASTER_PROFILE 0
+
+// Maximum bands per frame, excluding the terminator. Bands must be at least 2 scanlines apart.
+#define RASTER_MAX_BANDS 14
+
+typedef enum raster_effect_t {
+    RASTER_NONE,
+    RASTER_TITLE_SHIMMER,   // Heat shimmer on the title logo
+    RASTER_SKY_CLOUDS       // Cloud layers swaying with the wind, nearer layers sway more
+} raster_effect_t;
+
+#if RASTER_PROFILE
+    extern uint8_t rasterIsrMaxCost;
+#endif
+
+void setRasterEffect(raster_effect_t effect);
+// Background scroll applied from line 0, at each VBlank
+void setRasterScroll(uint8_t x, uint8_t y);
+// Prepare the bands for the next frame (once per main loop iteration)
+void updateRaster();
+// Called from the VBlank interrupt: switch to the prepared bands, restore line 0 registers and arm the first band
+void rasterVBlank();
+// LCD (LYC) interrupt handler
+void rasterLcdIsr();
+
+#endif
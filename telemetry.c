@@ -0,0 +1,93 @@
+#include <gb/gb.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+// Initial stack pointer set by GBDK's crt0, the stack grows down to the end of the telemetry block
+#define STACK_TOP 0xE000
+#define STACK_BOTTOM (TELEMETRY_ADDRESS + sizeof(telemetry_t))
+#define STACK_PAINT 0xA5
+// Bytes left unpainted below the current stack pointer while painting
+#define STACK_PAINT_MARGIN 32
+// Painted bytes never come back, so the watermark is exact however rarely it is scanned
+#define STACK_SCAN_PERIOD 64
+
+uint8_t telemetryLastVBlank = 0;
+// Timer overflows during a screen load (saturated), the 8-bit timer alone wraps after 4096 CPU cycles
+volatile uint8_t telemetryTimerOverflows = 0;
+
+
+void telemetryTimerIsr() {
+    if (telemetryTimerOverflows != 0xFF) {
+        telemetryTimerOverflows++;
+    }
+}
+
+
+void telemetryInit() {
+    memset(TELEMETRY, 0, sizeof(telemetry_t));
+    memcpy(TELEMETRY->magic, "TLMY", 4);
+    TELEMETRY->version = TELEMETRY_VERSION;
+
+    // Locals live on the stack, the one of this function is close to the current stack pointer
+    uint8_t marker = STACK_PAINT;
+    for (uint8_t* p = (uint8_t*)STACK_BOTTOM; p < &marker - STACK_PAINT_MARGIN; p++) {
+        *p = STACK_PAINT;
+    }
+
+    TAC_REG = 0x05;     // Timer enabled, 262144 Hz: one tick every 16 CPU cycles (in both CPU speeds)
+    CRITICAL {
+        add_TIM(telemetryTimerIsr);
+    }
+}
+
+void telemetryFrame() {
+    TELEMETRY->frames++;
+
+    // Low byte of the VBlank counter can be read atomically
+    uint8_t now = (uint8_t)TELEMETRY->vblanks;
+    uint8_t missed = now - telemetryLastVBlank - 1;
+    telemetryLastVBlank = now;
+    // Wraps around when no VBlank happened at all, while the display was off for a screen load
+    if (missed != 0 && missed < 0x80) {
+        TELEMETRY->lagFrames += missed;
+        if (missed > TELEMETRY->maxLag) {
+            TELEMETRY->maxLag = missed;
+        }
+    }
+
+    if (!((uint8_t)TELEMETRY->frames % STACK_SCAN_PERIOD)) {
+        const uint8_t* p = (const uint8_t*)STACK_BOTTOM;
+        while (p < (const uint8_t*)STACK_TOP && *p == STACK_PAINT) {
+            p++;
+        }
+        uint16_t depth = STACK_TOP - (uint16_t)p;
+        if (depth > TELEMETRY->stackPeak) {
+            TELEMETRY->stackPeak = depth;
+        }
+    }
+}
+
+// Timer interrupt is only enabled during screen loads
+void telemetryLoadStart() {
+    CRITICAL {
+        telemetryTimerOverflows = 0;
+        TIMA_REG = 0;
+        IF_REG &= ~TIM_IFLAG;
+    }
+    set_interrupts(IE_REG | TIM_IFLAG);
+}
+
+void telemetryLoadEnd(uint8_t screen) {
+    uint8_t ticks = TIMA_REG;
+    set_interrupts(IE_REG & ~TIM_IFLAG);
+    uint8_t overflows = telemetryTimerOverflows;
+    // Overflow raised right before reading the timer, but not handled yet
+    if ((IF_REG & TIM_IFLAG) && ticks < 0x80 && overflows != 0xFF) {
+        overflows++;
+    }
+    uint16_t cost = ((uint16_t)overflows << 8) | ticks;
+    if (cost > TELEMETRY->screenLoadMaxCost[screen]) {
+        TELEMETRY->screenLoadMaxCost[screen] = cost;
+    }
+}
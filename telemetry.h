@@ -0,0 +1,42 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <gb/gb.h>
+
+// Runtime counters kept for the whole session, at a fixed WRAM address, for tools/telemetry (see there for the layout).
+// The rest of WRAM up to the initial stack pointer is the painted stack window: game variables must stay below,
+// the Makefile checks linked WRAM areas against this address in the map file.
+#define TELEMETRY_ADDRESS 0xDE00
+#define TELEMETRY_VERSION 3
+// Title, instructions, game and winning screens, in screen_t order
+#define TELEMETRY_SCREENS 4
+// RASTER_MAX_BANDS (checked in raster.c)
+#define TELEMETRY_RASTER_BANDS 14
+
+typedef struct telemetry_t {
+    char magic[4];              // "TLMY"
+    uint8_t version;
+    uint32_t frames;            // Main loop iterations
+    uint32_t vblanks;           // VBlank interrupts
+    uint32_t lagFrames;         // VBlanks missed by the main loop (an iteration spanning n VBlanks misses n - 1)
+    uint8_t maxLag;             // Most VBlanks missed by a single iteration
+    uint8_t foodPeak;           // Most food active at once
+    uint8_t vblankIsrMaxCost;   // Longest vblank_isr(), in units of 16 CPU cycles
+    uint16_t stackPeak;         // Deepest stack use, in bytes below the initial stack pointer
+    uint32_t spawnAttempts;     // Food slot lookups
+    uint32_t spawnSlots;        // Food slot lookups that found a free slot
+    uint16_t screenLoadMaxCost[TELEMETRY_SCREENS];  // Longest load of each screen, in units of 16 CPU cycles
+    uint8_t rasterIsrMaxCost[TELEMETRY_RASTER_BANDS];   // Longest LCD interrupt of each raster band, in units of 16 CPU cycles (RASTER_PROFILE only)
+} telemetry_t;
+
+#define TELEMETRY ((telemetry_t*)TELEMETRY_ADDRESS)
+
+// Reset counters, paint the stack window and start the timer used to measure interrupts (at boot, first thing)
+void telemetryInit();
+// Count lag and update the stack watermark (once per main loop iteration, right after VBlank)
+void telemetryFrame();
+// Around a screen load, while the display is off
+void telemetryLoadStart();
+void telemetryLoadEnd(uint8_t screen);
+
+#endif
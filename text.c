@@ -0,0 +1,71 @@
+#include <gb/gb.h>
+
+#include "text.h"
+
+#include "tilesets/font_tiles.h"
+
+#if font_tiles_count != FONT_GLYPHS
+    #error "text/game_text.txt @font line does not match tilesets/font.png"
+#endif
+
+#define MAX_DIGITS 5
+
+typedef struct text_write_t {
+    text_layer_t layer;
+    uint8_t x, y;
+    uint8_t length;
+    const uint8_t* tiles;
+    uint8_t digits[MAX_DIGITS];     // Tiles of printed numbers
+} text_write_t;
+text_write_t textQueue[TEXT_QUEUE_SIZE];
+uint8_t textQueued = 0;
+
+const uint32_t powersOfTen[MAX_DIGITS] = { 10000, 1000, 100, 10, 1 };
+
+
+text_write_t* queueText(text_layer_t layer, uint8_t x, uint8_t y, uint8_t length) {
+    if (textQueued == TEXT_QUEUE_SIZE) {
+        flushText();
+    }
+    text_write_t* write = &textQueue[textQueued++];
+    write->layer = layer;
+    write->x = x;
+    write->y = y;
+    write->length = length;
+    return write;
+}
+
+void printText(text_layer_t layer, uint8_t x, uint8_t y, const uint8_t* text, uint8_t length) {
+    queueText(layer, x, y, length)->tiles = text;
+}
+
+void printNumber(text_layer_t layer, uint8_t x, uint8_t y, uint32_t value, uint8_t digits) {
+    text_write_t* write = queueText(layer, x, y, digits);
+    write->tiles = write->digits;
+    // Repeated subtraction: no division on the CPU, at most 9 subtractions per digit once clamped
+    const uint32_t* power = &powersOfTen[MAX_DIGITS - digits];
+    if (value >= *power * 10) {
+        value = *power * 10 - 1;
+    }
+    uint8_t* tile = write->digits;
+    for (uint8_t d = 0; d < digits; d++, power++, tile++) {
+        uint8_t digit = 0;
+        while (value >= *power) {
+            value -= *power;
+            digit++;
+        }
+        *tile = FONT_DIGIT_START + digit;
+    }
+}
+
+void flushText() {
+    text_write_t* write = textQueue;
+    for (uint8_t i = 0; i < textQueued; i++, write++) {
+        if (write->layer == TEXT_WIN) {
+            set_win_tiles(write->x, write->y, write->length, 1, write->tiles);
+        } else {
+            set_bkg_tiles(write->x, write->y, write->length, 1, write->tiles);
+        }
+    }
+    textQueued = 0;
+}
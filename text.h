@@ -0,0 +1,26 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <gb/gb.h>
+
+#include "text/game_text.h"
+
+// Pending map writes, flushed at once right after VBlank. A full queue is flushed immediately.
+#define TEXT_QUEUE_SIZE 6
+
+typedef enum text_layer_t {
+    TEXT_BKG,
+    TEXT_WIN
+} text_layer_t;
+
+// Queue an encoded string (see text/game_text.txt), only its pointer is kept: it must outlive the next flush
+void printText(text_layer_t layer, uint8_t x, uint8_t y, const uint8_t* text, uint8_t length);
+// Queue a zero-padded decimal value (up to 5 digits, larger values are clamped to all nines)
+void printNumber(text_layer_t layer, uint8_t x, uint8_t y, uint32_t value, uint8_t digits);
+// Write queued text to the background and window maps (right after VBlank, or with the display off)
+void flushText();
+
+// Encoded string from text/game_text.txt, by name
+#define PRINT_TEXT(layer, x, y, name) printText(layer, x, y, text_##name, text_##name##_length)
+
+#endif
@@ -0,0 +1,98 @@
+-- Scripted session recorder for the mGBA scripting API (0.10+).
+-- A session script (see tools/sessions/) defines the `session` table, then runs this file:
+--   session = {
+--       out = "_frames/name",              -- Output directory, must exist (FRAMES_OUT environment variable overrides it)
+--       inputs = { { frame = 60, keys = { "START" } }, { frame = 62, keys = {} } },    -- Keys held from frame on
+--       dumps = { 30, 120 },                -- Frames to dump, in increasing order
+--       wram = true,                        -- Optional, also dump WRAM (0xC000-0xDFFF) to .wram files
+--   }
+-- Each dump is a .gbdump file, see tools/gbframe.c for the format. The emulator exits after the last dump.
+-- Background registers of each line are rebuilt from the raster band list at the address of _rasterFront given in the
+-- RASTER_FRONT environment variable (set by the Makefile from the symbol file), the registers at VBlank otherwise.
+-- OAM and LCDC of every frame of the session are also logged to frames.oamlog, for tools/oamscan.
+-- WRAM dumps hold the runtime telemetry block (see tools/telemetry.c), and the OAM trace of builds with OAM_TRACE set
+-- (see tools/oamscan.c).
+
+local KEYS = { A = 0, B = 1, SELECT = 2, START = 3, RIGHT = 4, LEFT = 5, UP = 6, DOWN = 7 }
+-- LCDC, STAT, SCY, SCX, LY, LYC, BGP, OBP0, OBP1, WY, WX
+local REGISTERS = { 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x47, 0x48, 0x49, 0x4A, 0x4B }
+
+-- Line 0 values, bands and terminator (RASTER_MAX_BANDS + 2 in raster.h)
+local RASTER_BANDS = 16
+local RASTER_END = 0xFF
+local rasterFront = tonumber(os.getenv("RASTER_FRONT") or "")
+
+local out = os.getenv("FRAMES_OUT") or session.out
+
+local frame = 0
+local nextInput = 1
+local nextDump = 1
+local oamLog = assert(io.open(out .. "/frames.oamlog", "wb"))
+oamLog:write("OAML")
+
+local function u32(value)
+    return string.char(value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF)
+end
+
+-- SCY, SCX, BGP of each line. Called at the start of VBlank, before vblank_isr() switches to the next band list.
+local function lineRegisters()
+    local scy, scx, bgp = emu.memory.io:read8(0x42), emu.memory.io:read8(0x43), emu.memory.io:read8(0x47)
+    local band, nextLine, remaining = 0, RASTER_END, RASTER_BANDS
+    if rasterFront then
+        band = emu:read16(rasterFront)
+        nextLine = emu:read8(band)
+    end
+    local lines = {}
+    for line = 0, 143 do
+        -- raster_band_t: line, scx, scy, bgp
+        while nextLine <= line and remaining > 0 do
+            scx, scy, bgp = emu:read8(band + 1), emu:read8(band + 2), emu:read8(band + 3)
+            band = band + 4
+            nextLine = emu:read8(band)
+            remaining = remaining - 1
+        end
+        lines[#lines + 1] = string.char(scy, scx, bgp)
+    end
+    return table.concat(lines)
+end
+
+local function dump()
+    local file = assert(io.open(string.format("%s/%05d.gbdump", out, frame), "wb"))
+    file:write("GBFD", u32(frame))
+    for i = 1, 16 do
+        local register = REGISTERS[i]
+        file:write(string.char(register and emu.memory.io:read8(register) or 0))
+    end
+    file:write(emu.memory.vram:readRange(0, 0x2000))
+    file:write(emu.memory.oam:readRange(0, 0xA0))
+    file:write(lineRegisters())
+    file:close()
+    if session.wram then
+        file = assert(io.open(string.format("%s/%05d.wram", out, frame), "wb"))
+        file:write(emu.memory.wram:readRange(0, 0x2000))
+        file:close()
+    end
+end
+
+callbacks:add("frame", function()
+    frame = frame + 1
+    -- OAM as displayed during this frame
+    oamLog:write(u32(frame), string.char(emu.memory.io:read8(0x40)), emu.memory.oam:readRange(0, 0xA0))
+    local input = session.inputs[nextInput]
+    if input and input.frame == frame then
+        local mask = 0
+        for _, key in ipairs(input.keys) do
+            mask = mask | (1 << KEYS[key])
+        end
+        emu:setKeys(mask)
+        nextInput = nextInput + 1
+    end
+    if session.dumps[nextDump] == frame then
+        dump()
+        nextDump = nextDump + 1
+        if nextDump > #session.dumps then
+            oamLog:close()
+            os.exit(0)
+        end
+    end
+end)
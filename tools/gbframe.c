@@ -0,0 +1,230 @@
+// Host tool: rebuild the 160x144 screen from VRAM, OAM and LCD registers dumps, write PPM images and per-frame hashes.
+//
+// Usage: gbframe [-o outdir] dump...
+// Prints "<frame> <hash>" for each dump, hash is FNV-1a 64 of the 160x144 shades (0 = white to 3 = black).
+// With -o, also writes <outdir>/<frame>.ppm
+//
+// Dump format (.gbdump), written by tools/dump_frames.lua from an emulator, or by any native build of the game loop:
+//   4 bytes    "GBFD"
+//   4 bytes    frame number, little endian
+//   16 bytes   LCDC, STAT, SCY, SCX, LY, LYC, BGP, OBP0, OBP1, WY, WX, then 5 unused bytes
+//   8192 bytes VRAM bank 0 (0x8000-0x9FFF)
+//   160 bytes  OAM (0xFE00-0xFE9F)
+//   144 x 3 bytes  SCY, SCX, BGP of each line
+//
+// Registers are sampled at the start of VBlank. Background scroll and palette change mid-frame (raster effects):
+// the per-line values are rebuilt from the raster band list the frame was drawn with (see raster.c), the other
+// registers apply to the whole screen.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostio.h"
+
+#define SCREEN_WIDTH 160
+#define SCREEN_HEIGHT 144
+#define DUMP_SIZE (4 + 4 + 16 + 0x2000 + 0xA0 + SCREEN_HEIGHT * 3)
+
+enum { LCDC, STAT, SCY, SCX, LY, LYC, BGP, OBP0, OBP1, WY, WX };
+enum { LINE_SCY, LINE_SCX, LINE_BGP };
+
+typedef struct dump_t {
+    uint32_t frame;
+    uint8_t regs[16];
+    uint8_t vram[0x2000];
+    uint8_t oam[0xA0];
+    uint8_t lines[SCREEN_HEIGHT][3];
+} dump_t;
+
+static const uint8_t grays[4] = { 0xFF, 0xAA, 0x55, 0x00 };
+
+
+static int readDump(const char* path, dump_t* dump) {
+    uint8_t buffer[DUMP_SIZE];
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    size_t size = fread(buffer, 1, sizeof(buffer), f);
+    fclose(f);
+    if (size != DUMP_SIZE || memcmp(buffer, "GBFD", 4) != 0) {
+        fprintf(stderr, "%s: not a frame dump\n", path);
+        return 0;
+    }
+    dump->frame = readU32(buffer + 4);
+    memcpy(dump->regs, buffer + 8, 16);
+    memcpy(dump->vram, buffer + 24, 0x2000);
+    memcpy(dump->oam, buffer + 24 + 0x2000, 0xA0);
+    memcpy(dump->lines, buffer + 24 + 0x2000 + 0xA0, SCREEN_HEIGHT * 3);
+    return 1;
+}
+
+// Color index (0-3) of a pixel in a tile, from its address in VRAM
+static uint8_t tilePixel(const dump_t* dump, uint16_t tileAddr, uint8_t x, uint8_t y) {
+    uint8_t low = dump->vram[tileAddr + y * 2];
+    uint8_t high = dump->vram[tileAddr + y * 2 + 1];
+    uint8_t bit = 7 - x;
+    return ((low >> bit) & 1) | (((high >> bit) & 1) << 1);
+}
+
+// Background and window tiles use either 0x8000 unsigned or 0x9000 signed addressing
+static uint16_t bkgTileAddr(const dump_t* dump, uint8_t tile) {
+    if (dump->regs[LCDC] & 0x10) {
+        return tile * 16;
+    }
+    return 0x1000 + (int8_t)tile * 16;
+}
+
+static uint8_t shade(uint8_t palette, uint8_t color) {
+    return (palette >> (color * 2)) & 0x03;
+}
+
+static void render(const dump_t* dump, uint8_t* shades) {
+    const uint8_t* regs = dump->regs;
+    uint8_t lcdc = regs[LCDC];
+    if (!(lcdc & 0x80)) {
+        memset(shades, 0, SCREEN_WIDTH * SCREEN_HEIGHT);
+        return;
+    }
+    uint8_t spriteHeight = (lcdc & 0x04) ? 16 : 8;
+    int windowX = regs[WX] - 7;
+    for (int line = 0; line < SCREEN_HEIGHT; line++) {
+        uint8_t* out = shades + line * SCREEN_WIDTH;
+        const uint8_t* lineRegs = dump->lines[line];
+        uint8_t colors[SCREEN_WIDTH];
+
+        // Background and window (both disabled when LCDC bit 0 is cleared on DMG)
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            uint8_t color = 0;
+            if (lcdc & 0x01) {
+                uint16_t map;
+                uint8_t px, py;
+                if ((lcdc & 0x20) && line >= regs[WY] && x >= windowX && windowX < SCREEN_WIDTH) {
+                    map = (lcdc & 0x40) ? 0x1C00 : 0x1800;
+                    px = x - windowX;
+                    py = line - regs[WY];
+                } else {
+                    map = (lcdc & 0x08) ? 0x1C00 : 0x1800;
+                    px = (uint8_t)(x + lineRegs[LINE_SCX]);
+                    py = (uint8_t)(line + lineRegs[LINE_SCY]);
+                }
+                uint8_t tile = dump->vram[map + (py / 8) * 32 + px / 8];
+                color = tilePixel(dump, bkgTileAddr(dump, tile), px % 8, py % 8);
+            }
+            colors[x] = color;
+            out[x] = shade(lineRegs[LINE_BGP], color);
+        }
+
+        if (!(lcdc & 0x02)) {
+            continue;
+        }
+
+        // Sprites: the first 10 in OAM order on this line are displayed
+        int selected[10];
+        int count = 0;
+        for (int i = 0; i < 40 && count < 10; i++) {
+            int y = dump->oam[i * 4] - 16;
+            if (line >= y && line < y + spriteHeight) {
+                selected[count++] = i;
+            }
+        }
+        // On DMG, lower X has priority, then lower OAM index
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            int best = -1;
+            uint8_t bestColor = 0;
+            for (int s = 0; s < count; s++) {
+                const uint8_t* sprite = dump->oam + selected[s] * 4;
+                int sx = sprite[1] - 8;
+                if (x < sx || x >= sx + 8) {
+                    continue;
+                }
+                if (best != -1 && dump->oam[best * 4 + 1] <= sprite[1]) {
+                    continue;
+                }
+                uint8_t flags = sprite[3];
+                uint8_t row = line - (sprite[0] - 16);
+                uint8_t col = x - sx;
+                if (flags & 0x40)   row = spriteHeight - 1 - row;
+                if (flags & 0x20)   col = 7 - col;
+                uint8_t tile = (spriteHeight == 16) ? (sprite[2] & 0xFE) : sprite[2];
+                uint8_t color = tilePixel(dump, tile * 16 + (row / 8) * 16, col, row % 8);
+                if (color == 0) {
+                    continue;
+                }
+                best = selected[s];
+                bestColor = color;
+            }
+            if (best == -1) {
+                continue;
+            }
+            uint8_t flags = dump->oam[best * 4 + 3];
+            // Behind background colors 1-3
+            if ((flags & 0x80) && colors[x] != 0) {
+                continue;
+            }
+            out[x] = shade((flags & 0x10) ? regs[OBP1] : regs[OBP0], bestColor);
+        }
+    }
+}
+
+static uint64_t hashShades(const uint8_t* shades) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        hash ^= shades[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static int writePpm(const char* path, const uint8_t* shades) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        uint8_t gray = grays[shades[i]];
+        fputc(gray, f);
+        fputc(gray, f);
+        fputc(gray, f);
+    }
+    fclose(f);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    const char* outDir = NULL;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+        outDir = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [-o outdir] dump...\n", argv[0]);
+        return 2;
+    }
+
+    static dump_t dump;
+    static uint8_t shades[SCREEN_WIDTH * SCREEN_HEIGHT];
+    int status = 0;
+    for (int i = first; i < argc; i++) {
+        if (!readDump(argv[i], &dump)) {
+            status = 1;
+            continue;
+        }
+        render(&dump, shades);
+        printf("%05u %016llx\n", dump.frame, (unsigned long long)hashShades(shades));
+        if (outDir) {
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%05u.ppm", outDir, dump.frame);
+            if (!writePpm(path, shades)) {
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
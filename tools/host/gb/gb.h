@@ -0,0 +1,24 @@
+// Minimal GBDK stand-in to build link.c on the host, for tools/linkloop.c
+#ifndef HOST_GB_H
+#define HOST_GB_H
+
+#include <stdint.h>
+
+#define J_RIGHT 0x01
+#define J_LEFT 0x02
+#define J_UP 0x04
+#define J_DOWN 0x08
+#define J_A 0x10
+#define J_B 0x20
+#define J_SELECT 0x40
+#define J_START 0x80
+
+extern volatile uint8_t SB_REG, SC_REG;
+extern volatile uint16_t sys_time;
+
+// Critical sections exclude the emulated serial interrupt, and give the master a chance to run its transfers
+void hostLock(void);
+void hostUnlock(void);
+#define CRITICAL for (int critical_ = (hostLock(), 1); critical_; critical_ = 0, hostUnlock())
+
+#endif
@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hostio.h"
+
+
+uint32_t readU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint8_t* readFile(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* buffer = malloc(length > 0 ? length : 1);
+    if (buffer && fread(buffer, 1, length, f) != (size_t)length) {
+        free(buffer);
+        buffer = NULL;
+        fprintf(stderr, "%s: read error\n", path);
+    }
+    fclose(f);
+    *size = length;
+    return buffer;
+}
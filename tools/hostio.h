@@ -0,0 +1,13 @@
+// Shared helpers of the host tools, for reading dumps
+#ifndef HOSTIO_H
+#define HOSTIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Little endian, as stored by the Game Boy
+uint32_t readU32(const uint8_t* p);
+// Whole file in a malloc'ed buffer, NULL (with a message) on error
+uint8_t* readFile(const char* path, size_t* size);
+
+#endif
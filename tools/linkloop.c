@@ -0,0 +1,257 @@
+// Host tool: run link.c on two host processes connected by pipes, standing in for two consoles and a link cable.
+//
+// Usage: linkloop [frames]
+// The master starts hosting a game and cancels it halfway through the handshake, then hosts again: the slave must join
+// the second one. Then both play random inputs with random stalls.
+// Succeeds when both agree on the handshake and on the inputs of both players at every frame,
+// and when local inputs are applied exactly LINK_INPUT_DELAY frames after being pushed.
+//
+// Serial model: the master transfers synchronously when it starts one (SC = 0x81). The slave answers from a thread
+// standing in for its serial hardware and interrupt, whatever its main loop is doing: the transfer reaches it only
+// if it is armed (SC = 0x80), otherwise the master reads 0xFF and nothing is exchanged.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "link.h"
+
+#define SEED 0xBE5A      // LSB collides with the handshake HELLO byte, the host changes it
+#define SETTING 5
+// VBlanks to wait for the handshake
+#define HANDSHAKE_TIMEOUT 300
+
+volatile uint8_t SB_REG, SC_REG;
+volatile uint16_t sys_time;
+
+static int isMaster;
+static int toPeer, fromPeer;
+static uint32_t randomState;
+static pthread_mutex_t interruptLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static uint32_t nextRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static void writeByte(int fd, uint8_t value) {
+    while (write(fd, &value, 1) != 1) {
+        if (errno != EINTR) {
+            perror("write");
+            exit(2);
+        }
+    }
+}
+
+// Returns -1 on end of file
+static int readByte(int fd) {
+    uint8_t value;
+    ssize_t size;
+    while ((size = read(fd, &value, 1)) < 0) {
+        if (errno != EINTR) {
+            perror("read");
+            exit(2);
+        }
+    }
+    return size == 1 ? value : -1;
+}
+
+void hostLock(void) {
+    pthread_mutex_lock(&interruptLock);
+}
+
+void hostUnlock(void) {
+    pthread_mutex_unlock(&interruptLock);
+    if (isMaster && SC_REG == 0x81) {
+        writeByte(toPeer, SB_REG);
+        int reply = readByte(fromPeer);
+        pthread_mutex_lock(&interruptLock);
+        SB_REG = reply < 0 ? 0xFF : reply;
+        SC_REG = 0;
+        linkIsr();
+        pthread_mutex_unlock(&interruptLock);
+    } else if (!isMaster) {
+        // Let the serial thread in, polling loops would hold the lock most of the time
+        sched_yield();
+    }
+}
+
+// VBlank counter, for link timeouts
+static void* vblank(void* unused) {
+    (void)unused;
+    while (1) {
+        usleep(16742);
+        sys_time++;
+    }
+    return NULL;
+}
+
+// Slave serial port, until the master is done
+static void* slaveSerial(void* unused) {
+    (void)unused;
+    int data;
+    while ((data = readByte(fromPeer)) >= 0) {
+        pthread_mutex_lock(&interruptLock);
+        if (SC_REG == 0x80) {
+            writeByte(toPeer, SB_REG);
+            SB_REG = data;
+            SC_REG = 0;
+            linkIsr();
+        } else {
+            writeByte(toPeer, 0xFF);
+        }
+        pthread_mutex_unlock(&interruptLock);
+    }
+    return NULL;
+}
+
+static void stall(void) {
+    // Mostly short frames, sometimes a console lags for several frames
+    usleep((nextRandom() % 16 == 0) ? 20000 + nextRandom() % 30000 : nextRandom() % 2000);
+}
+
+// Returns 0 on timeout
+static int waitHandshake(void) {
+    uint16_t start = sys_time;
+    while (!linkReady()) {
+        if ((uint16_t)(sys_time - start) > HANDSHAKE_TIMEOUT) {
+            fprintf(stderr, "%s: no handshake\n", isMaster ? "master" : "slave");
+            return 0;
+        }
+        if (isMaster) {
+            linkPump();
+        }
+        usleep(1000);
+    }
+    return 1;
+}
+
+static uint64_t play(int frames, int* status) {
+    uint8_t pushed[256];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    linkStartGame();
+    for (int frame = 0; frame < frames; frame++) {
+        uint8_t joy = nextRandom();
+        if ((joy & (J_LEFT | J_RIGHT)) == (J_LEFT | J_RIGHT)) {
+            joy &= ~J_LEFT;
+        }
+        pushed[(uint8_t)(frame + LINK_INPUT_DELAY)] = joy;
+        linkPushInput(joy);
+        stall();
+
+        uint8_t masterJoy, slaveJoy;
+        if (!linkNextInputs(&masterJoy, &slaveJoy)) {
+            fprintf(stderr, "%s: link lost at frame %d\n", isMaster ? "master" : "slave", frame);
+            *status = 1;
+            return 0;
+        }
+        uint8_t local = isMaster ? masterJoy : slaveJoy;
+        uint8_t expected = frame < LINK_INPUT_DELAY ? 0 : pushed[(uint8_t)frame];
+        if (local != expected) {
+            fprintf(stderr, "%s: frame %d applied local input %02x instead of %02x\n", isMaster ? "master" : "slave", frame, local, expected);
+            *status = 1;
+        }
+        hash = (hash ^ masterJoy) * 0x100000001b3ULL;
+        hash = (hash ^ slaveJoy) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    int masterToSlave[2], slaveToMaster[2], results[2];
+    if (pipe(masterToSlave) || pipe(slaveToMaster) || pipe(results)) {
+        perror("pipe");
+        return 2;
+    }
+
+    pid_t slave = fork();
+    if (slave < 0) {
+        perror("fork");
+        return 2;
+    }
+    isMaster = slave != 0;
+    int status = 0;
+    pthread_t timer;
+    pthread_create(&timer, NULL, vblank, NULL);
+    if (!isMaster) {
+        toPeer = slaveToMaster[1];
+        fromPeer = masterToSlave[0];
+        close(masterToSlave[1]);
+        close(slaveToMaster[0]);
+        close(results[0]);
+        randomState = 0x2545F491;
+        pthread_t serial;
+        pthread_create(&serial, NULL, slaveSerial, NULL);
+        linkListen();
+        uint64_t hash = 0;
+        if (waitHandshake()) {
+            hash = play(frames, &status);
+        } else {
+            status = 1;
+        }
+        dprintf(results[1], "%04x %u %016llx %d\n", linkSeed, linkSetting, (unsigned long long)hash, status);
+        close(results[1]);
+        pthread_join(serial, NULL);
+        return status;
+    }
+
+    toPeer = masterToSlave[1];
+    fromPeer = slaveToMaster[0];
+    close(masterToSlave[0]);
+    close(slaveToMaster[1]);
+    close(results[1]);
+    randomState = 0x9E3779B9;
+    // Cancelled handshake, once the slave listens: HELLO and seed LSB only
+    usleep(100000);
+    linkHost(0x1234, 9);
+    linkPump();
+    linkPump();
+    // The slave may not listen yet, unanswered handshake bytes are sent again
+    linkHost(SEED, SETTING);
+    uint64_t hash = 0;
+    if (waitHandshake()) {
+        hash = play(frames, &status);
+    } else {
+        status = 1;
+    }
+
+    // The slave may still need the last exchanges
+    fcntl(results[0], F_SETFL, O_NONBLOCK);
+    char line[128];
+    ssize_t size;
+    while ((size = read(results[0], line, sizeof(line) - 1)) < 0 && errno == EAGAIN) {
+        linkPump();
+        usleep(1000);
+    }
+    close(toPeer);
+    waitpid(slave, NULL, 0);
+    line[size > 0 ? size : 0] = '\0';
+
+    unsigned seed, setting, slaveStatus;
+    unsigned long long slaveHash;
+    if (sscanf(line, "%x %u %llx %u", &seed, &setting, &slaveHash, &slaveStatus) != 4) {
+        fprintf(stderr, "No result from the slave\n");
+        return 1;
+    }
+    if (seed != linkSeed || setting != SETTING) {
+        fprintf(stderr, "Handshake mismatch: slave got seed %04x and setting %u\n", seed, setting);
+        status = 1;
+    }
+    if (slaveHash != hash || slaveStatus) {
+        fprintf(stderr, "Inputs differ: master %016llx, slave %016llx\n", (unsigned long long)hash, slaveHash);
+        status = 1;
+    }
+    printf("%d frames, input delay %d: %s\n", frames, LINK_INPUT_DELAY, status ? "DESYNC" : "lockstep");
+    return status;
+}
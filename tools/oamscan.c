@@ -0,0 +1,249 @@
+// Host tool: find scanlines with more than 10 sprites in OAM layouts, and which OAM entries the hardware drops there.
+//
+// Usage: oamscan [-16] file...
+// Each file is either:
+//   - an OAM log (frames.oamlog, written by tools/dump_frames.lua), every frame of a session
+//   - a frame dump (.gbdump, see tools/gbframe.c), one frame, sprite height from its LCDC
+//   - any memory dump containing the OAM trace ring buffer of a build with OAM_TRACE set in gbjam9.c
+//     (a WRAM dump written by tools/dump_frames.lua with `wram = true`, a save state...), up to 16 frames
+// Trace frames are deduplicated by sequence number, so overlapping dumps can be passed together.
+// -16 analyzes trace frames with 8x16 sprites (the game uses 8x8, trace frames do not carry LCDC).
+// Frames with sprites disabled in LCDC are skipped, trace frames are assumed to show sprites.
+//
+// OAM log layout: 4 bytes "OAML", then for each frame 4 bytes frame number (little endian), 1 byte LCDC, 160 bytes OAM.
+//
+// Trace layout (little endian, no padding):
+//   4 bytes    "OAMT"
+//   1 byte     number of entries
+//   1 byte     next entry to write
+//   4 bytes    sequence number of the last traced frame
+//   entries    4 bytes sequence number (0 when unused), 160 bytes shadow OAM
+//
+// Like the hardware, a sprite is counted on a line as soon as its Y covers it, whatever its X (even offscreen),
+// and only the first 10 in OAM order are displayed.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostio.h"
+
+#define SCREEN_HEIGHT 144
+#define OAM_COUNT 40
+#define SPRITES_PER_LINE 10
+#define GBFD_SIZE (4 + 4 + 16 + 0x2000 + 0xA0 + SCREEN_HEIGHT * 3)
+#define OAML_ENTRY_SIZE (4 + 1 + 0xA0)
+
+typedef struct frame_t {
+    uint32_t id;            // Frame number for dumps, sequence number for trace entries
+    uint8_t spriteHeight;
+    uint8_t spritesShown;   // LCDC bit 1, hidden sprites never overflow
+    uint8_t traced;
+    uint8_t oam[0xA0];
+} frame_t;
+
+typedef struct stats_t {
+    uint32_t frames;
+    uint32_t hiddenFrames;
+    uint32_t overflowFrames;
+    uint8_t worstLine[SCREEN_HEIGHT];       // Worst number of sprites on each line
+    uint32_t worstLineFrame[SCREEN_HEIGHT];
+    uint32_t droppedFrames[OAM_COUNT];      // Frames where the entry was dropped on at least one line
+    uint32_t droppedLines[OAM_COUNT];       // Lines where the entry was dropped, over all frames
+} stats_t;
+
+static frame_t* frames;
+static uint32_t frameCount;
+static uint32_t frameCapacity;
+
+
+// OAM allocation of gbjam9.c, keep in sync with the sprite numbers there
+static void describeEntry(int i, char* out, size_t size) {
+    if (i < 5) {
+        snprintf(out, size, "pause text %d", i);
+    } else if (i < 9) {
+        snprintf(out, size, "bird %d", i - 5);
+    } else if (i < 25) {
+        snprintf(out, size, "food slot %d %s", (i - 9) / 2, ((i - 9) % 2) ? "bottom" : "top");
+    } else if (i < 29) {
+        snprintf(out, size, "other bird %d", i - 25);
+    } else if (i == 39) {
+        snprintf(out, size, "countdown");
+    } else {
+        snprintf(out, size, "unused");
+    }
+}
+
+static int alreadySeen(uint32_t id) {
+    for (uint32_t i = 0; i < frameCount; i++) {
+        if (frames[i].traced && frames[i].id == id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void addFrame(uint32_t id, uint8_t spriteHeight, uint8_t spritesShown, uint8_t traced, const uint8_t* oam) {
+    if (frameCount == frameCapacity) {
+        frameCapacity = frameCapacity ? frameCapacity * 2 : 4096;
+        frames = realloc(frames, frameCapacity * sizeof(frame_t));
+        if (!frames) {
+            perror("realloc");
+            exit(2);
+        }
+    }
+    frame_t* frame = &frames[frameCount++];
+    frame->id = id;
+    frame->spriteHeight = spriteHeight;
+    frame->spritesShown = spritesShown;
+    frame->traced = traced;
+    memcpy(frame->oam, oam, 0xA0);
+}
+
+// Returns 0 when the file holds neither a frame dump nor a trace
+static int loadFile(const char* path, uint8_t traceSpriteHeight) {
+    size_t size;
+    uint8_t* buffer = readFile(path, &size);
+    if (!buffer) {
+        return -1;
+    }
+    int found = 0;
+    if (size == GBFD_SIZE && memcmp(buffer, "GBFD", 4) == 0) {
+        // Frame dumps are never deduplicated, their frame numbers may come from several sessions
+        uint8_t lcdc = buffer[8];
+        addFrame(readU32(buffer + 4), (lcdc & 0x04) ? 16 : 8, lcdc & 0x02, 0, buffer + 24 + 0x2000);
+        found = 1;
+    } else if (size >= 4 && memcmp(buffer, "OAML", 4) == 0) {
+        for (size_t offset = 4; offset + OAML_ENTRY_SIZE <= size; offset += OAML_ENTRY_SIZE) {
+            uint8_t lcdc = buffer[offset + 4];
+            addFrame(readU32(buffer + offset), (lcdc & 0x04) ? 16 : 8, lcdc & 0x02, 0, buffer + offset + 5);
+        }
+        found = 1;
+    } else {
+        for (size_t offset = 0; offset + 10 <= size; offset++) {
+            if (memcmp(buffer + offset, "OAMT", 4) != 0) {
+                continue;
+            }
+            uint8_t entries = buffer[offset + 4];
+            if (entries == 0 || offset + 10 + entries * (4 + 0xA0) > size) {
+                continue;
+            }
+            // Oldest entry first
+            uint8_t head = buffer[offset + 5] % entries;
+            found = 1;
+            for (uint8_t e = 0; e < entries; e++) {
+                const uint8_t* entry = buffer + offset + 10 + ((head + e) % entries) * (4 + 0xA0);
+                uint32_t sequence = readU32(entry);
+                if (sequence == 0 || alreadySeen(sequence)) {
+                    continue;
+                }
+                addFrame(sequence, traceSpriteHeight, 1, 1, entry + 4);
+            }
+            offset += 10 + entries * (4 + 0xA0) - 1;
+        }
+        if (!found) {
+            fprintf(stderr, "%s: no frame dump or OAM trace found\n", path);
+        }
+    }
+    free(buffer);
+    return found;
+}
+
+static void analyze(const frame_t* frame, stats_t* stats) {
+    if (!frame->spritesShown) {
+        stats->hiddenFrames++;
+        return;
+    }
+    uint8_t spriteHeight = frame->spriteHeight;
+    uint8_t dropped[OAM_COUNT] = { 0 };
+    int overflow = 0;
+    for (int line = 0; line < SCREEN_HEIGHT; line++) {
+        int count = 0;
+        for (int i = 0; i < OAM_COUNT; i++) {
+            int y = frame->oam[i * 4] - 16;
+            if (line < y || line >= y + spriteHeight) {
+                continue;
+            }
+            if (++count > SPRITES_PER_LINE) {
+                dropped[i] = 1;
+                stats->droppedLines[i]++;
+                overflow = 1;
+            }
+        }
+        if (count > stats->worstLine[line]) {
+            stats->worstLine[line] = count;
+            stats->worstLineFrame[line] = frame->id;
+        }
+    }
+    for (int i = 0; i < OAM_COUNT; i++) {
+        stats->droppedFrames[i] += dropped[i];
+    }
+    stats->frames++;
+    stats->overflowFrames += overflow;
+}
+
+int main(int argc, char** argv) {
+    uint8_t traceSpriteHeight = 8;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-16") == 0) {
+        traceSpriteHeight = 16;
+        first = 2;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [-16] file...\n", argv[0]);
+        return 2;
+    }
+
+    int status = 0;
+    for (int i = first; i < argc; i++) {
+        if (loadFile(argv[i], traceSpriteHeight) <= 0) {
+            status = 1;
+        }
+    }
+
+    static stats_t stats;
+    for (uint32_t i = 0; i < frameCount; i++) {
+        analyze(&frames[i], &stats);
+    }
+    if (stats.frames == 0) {
+        fprintf(stderr, "No frames to analyze (%u with sprites hidden)\n", stats.hiddenFrames);
+        return stats.hiddenFrames ? status : 1;
+    }
+
+    // Per-line worst case, 16 lines per row
+    int worst = 0;
+    int worstLine = 0;
+    printf("Worst sprites per line:\n");
+    for (int line = 0; line < SCREEN_HEIGHT; line++) {
+        if (line % 16 == 0) {
+            printf("  %3d:", line);
+        }
+        printf(" %2d%c", stats.worstLine[line], stats.worstLine[line] > SPRITES_PER_LINE ? '!' : ' ');
+        if (line % 16 == 15) {
+            printf("\n");
+        }
+        if (stats.worstLine[line] > worst) {
+            worst = stats.worstLine[line];
+            worstLine = line;
+        }
+    }
+
+    int anyDropped = 0;
+    for (int i = 0; i < OAM_COUNT; i++) {
+        if (!stats.droppedFrames[i]) {
+            continue;
+        }
+        if (!anyDropped) {
+            printf("Dropped entries:\n");
+            anyDropped = 1;
+        }
+        char role[32];
+        describeEntry(i, role, sizeof(role));
+        printf("  OAM %2d (%s): %u frames, %u lines\n", i, role, stats.droppedFrames[i], stats.droppedLines[i]);
+    }
+
+    printf("%u frames (%u skipped, sprites hidden), %u with overflow, worst %d sprites on line %d (frame %u)\n",
+        stats.frames, stats.hiddenFrames, stats.overflowFrames, worst, worstLine, stats.worstLineFrame[worstLine]);
+    return stats.overflowFrames ? 1 : status;
+}
@@ -0,0 +1,27 @@
+-- First minute of a game, with flapping, diving, direction changes and pause
+session = {
+    out = "_frames/game",
+    inputs = {
+        { frame = 60, keys = { "START" } },
+        { frame = 62, keys = {} },
+        { frame = 120, keys = { "LEFT" } },
+        { frame = 122, keys = {} },
+        { frame = 123, keys = { "A" } },
+        { frame = 125, keys = {} },
+        { frame = 200, keys = { "A" } },
+        { frame = 202, keys = {} },
+        { frame = 260, keys = { "DOWN" } },
+        { frame = 320, keys = {} },
+        { frame = 400, keys = { "RIGHT" } },
+        { frame = 402, keys = {} },
+        { frame = 500, keys = { "START" } },
+        { frame = 502, keys = {} },
+        { frame = 560, keys = { "START" } },
+        { frame = 562, keys = {} },
+        { frame = 1000, keys = { "A" } },
+        { frame = 1002, keys = {} },
+    },
+    dumps = { 124, 150, 210, 300, 330, 410, 530, 700, 900, 1200, 1600, 2000, 2400, 2800, 3200, 3600 },
+    wram = true,    -- Runtime telemetry, see tools/telemetry.c
+}
+dofile("tools/dump_frames.lua")
@@ -0,0 +1,12 @@
+-- Title screen, then instructions screen with the duration changed
+session = {
+    out = "_frames/title",
+    inputs = {
+        { frame = 60, keys = { "START" } },
+        { frame = 62, keys = {} },
+        { frame = 120, keys = { "RIGHT" } },
+        { frame = 122, keys = {} },
+    },
+    dumps = { 30, 58, 100, 140 },
+}
+dofile("tools/dump_frames.lua")
@@ -0,0 +1,140 @@
+// Host tool: extract the runtime telemetry block of gbjam9 (telemetry.h) from memory dumps.
+//
+// Usage: telemetry file...
+// Each file is any uncompressed dump containing WRAM: a WRAM dump written by tools/dump_frames.lua with `wram = true`,
+// a full memory dump, an uncompressed save state... Files are listed in order, so dumps of one session show its trend.
+//
+// Block layout (little endian, no padding), at 0xDE00 in WRAM:
+//   4 bytes    "TLMY"
+//   1 byte     version (3)
+//   4 bytes    main loop iterations
+//   4 bytes    VBlank interrupts
+//   4 bytes    VBlanks missed by the main loop
+//   1 byte     most VBlanks missed by a single iteration
+//   1 byte     most food active at once
+//   1 byte     longest vblank_isr(), in units of 16 CPU cycles
+//   2 bytes    deepest stack use, in bytes below 0xE000
+//   4 bytes    food slot lookups
+//   4 bytes    food slot lookups that found a free slot
+//   4 x 2 bytes    longest load of the title, instructions, game and winning screens, in units of 16 CPU cycles
+//   14 bytes   longest LCD interrupt of each raster band, in units of 16 CPU cycles (0 unless built with RASTER_PROFILE)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostio.h"
+
+#define TELEMETRY_VERSION 3
+#define TELEMETRY_SCREENS 4
+#define TELEMETRY_RASTER_BANDS 14
+#define TELEMETRY_SIZE (30 + 2 * TELEMETRY_SCREENS + TELEMETRY_RASTER_BANDS)
+// Painted stack window, from the end of the block to the initial stack pointer
+#define STACK_WINDOW (0xE000 - 0xDE00 - TELEMETRY_SIZE)
+
+typedef struct telemetry_t {
+    uint32_t frames;
+    uint32_t vblanks;
+    uint32_t lagFrames;
+    uint8_t maxLag;
+    uint8_t foodPeak;
+    uint8_t vblankIsrMaxCost;
+    uint16_t stackPeak;
+    uint32_t spawnAttempts;
+    uint32_t spawnSlots;
+    uint16_t screenLoadMaxCost[TELEMETRY_SCREENS];
+    uint8_t rasterIsrMaxCost[TELEMETRY_RASTER_BANDS];
+} telemetry_t;
+
+static const char* screenNames[TELEMETRY_SCREENS] = { "title", "instructions", "game", "winning" };
+
+
+static double percent(uint32_t part, uint32_t total) {
+    return total ? 100.0 * part / total : 0.0;
+}
+
+static void print(const char* path, const telemetry_t* t) {
+    printf("%s:\n", path);
+    printf("  frames        %u main loop iterations, %u VBlanks\n", t->frames, t->vblanks);
+    printf("  lag           %u VBlanks missed (%.2f%%), worst %u in a row\n",
+        t->lagFrames, percent(t->lagFrames, t->vblanks), t->maxLag);
+    printf("  vblank_isr    %u cycles max\n", t->vblankIsrMaxCost * 16);
+    printf("  stack         %u bytes max, of %u painted%s\n",
+        t->stackPeak, STACK_WINDOW, t->stackPeak >= STACK_WINDOW ? " (OVERFLOW, telemetry may be corrupted)" : "");
+    printf("  food          %u active max, %u of %u slot lookups found a slot (%.1f%%)\n",
+        t->foodPeak, t->spawnSlots, t->spawnAttempts, percent(t->spawnSlots, t->spawnAttempts));
+    // Saturated at 0xFFFF (about 1 million cycles)
+    printf("  screen loads ");
+    for (int i = 0; i < TELEMETRY_SCREENS; i++) {
+        printf(" %s %u%s", screenNames[i], t->screenLoadMaxCost[i] * 16, t->screenLoadMaxCost[i] == 0xFFFF ? "+" : "");
+    }
+    printf(" cycles max\n");
+    // Bands are numbered from the first one after line 0, the screen effect sets how many are used
+    int profiled = 0;
+    for (int i = 0; i < TELEMETRY_RASTER_BANDS; i++) {
+        profiled |= t->rasterIsrMaxCost[i];
+    }
+    if (profiled) {
+        printf("  raster bands ");
+        for (int i = 0; i < TELEMETRY_RASTER_BANDS; i++) {
+            printf(" %u", t->rasterIsrMaxCost[i] * 16);
+        }
+        printf(" cycles max\n");
+    } else {
+        printf("  raster bands  not profiled (RASTER_PROFILE)\n");
+    }
+}
+
+// Returns 0 when the file holds no telemetry block, 2 on stack overflow
+static int extract(const char* path) {
+    size_t size;
+    uint8_t* buffer = readFile(path, &size);
+    if (!buffer) {
+        return -1;
+    }
+    int found = 0;
+    for (size_t offset = 0; offset + TELEMETRY_SIZE <= size; offset++) {
+        const uint8_t* p = buffer + offset;
+        if (memcmp(p, "TLMY", 4) != 0 || p[4] != TELEMETRY_VERSION) {
+            continue;
+        }
+        telemetry_t t = {
+            .frames = readU32(p + 5),
+            .vblanks = readU32(p + 9),
+            .lagFrames = readU32(p + 13),
+            .maxLag = p[17],
+            .foodPeak = p[18],
+            .vblankIsrMaxCost = p[19],
+            .stackPeak = p[20] | (p[21] << 8),
+            .spawnAttempts = readU32(p + 22),
+            .spawnSlots = readU32(p + 26),
+        };
+        for (int i = 0; i < TELEMETRY_SCREENS; i++) {
+            t.screenLoadMaxCost[i] = p[30 + 2 * i] | (p[31 + 2 * i] << 8);
+        }
+        memcpy(t.rasterIsrMaxCost, p + 30 + 2 * TELEMETRY_SCREENS, TELEMETRY_RASTER_BANDS);
+        print(path, &t);
+        found = t.stackPeak >= STACK_WINDOW ? 2 : 1;
+        break;
+    }
+    if (!found) {
+        fprintf(stderr, "%s: no telemetry block found\n", path);
+    }
+    free(buffer);
+    return found;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s file...\n", argv[0]);
+        return 2;
+    }
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        if (extract(argv[i]) != 1) {
+            status = 1;
+        }
+    }
+    return status;
+}
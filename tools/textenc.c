@@ -0,0 +1,141 @@
+// Host tool: encode on-screen strings to font tile numbers, so the game copies them without any conversion.
+//
+// Usage: textenc strings.txt out.c out.h
+// See text/game_text.txt for the input format.
+//
+// The font is loaded at the end of the 256 tiles space (FONT_TILE_NUM_START), on every screen, so encoded strings
+// are absolute tile numbers. Digits must be contiguous in the font, numbers are printed from FONT_DIGIT_START.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE 256
+#define MAX_NAME 64
+
+static char glyphs[MAX_LINE];
+static size_t glyphsCount;
+
+
+static int glyphIndex(char c) {
+    const char* found = memchr(glyphs, c, glyphsCount);
+    return found ? (int)(found - glyphs) : -1;
+}
+
+static void stripNewline(char* line) {
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+        line[--length] = '\0';
+    }
+}
+
+static int isNameChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s strings.txt out.c out.h\n", argv[0]);
+        return 2;
+    }
+    const char* inPath = argv[1];
+    FILE* in = fopen(inPath, "r");
+    if (!in) {
+        perror(inPath);
+        return 1;
+    }
+    FILE* c = fopen(argv[2], "w");
+    FILE* h = fopen(argv[3], "w");
+    if (!c || !h) {
+        perror(!c ? argv[2] : argv[3]);
+        return 1;
+    }
+
+    // Include guard from the output file name, e.g. GAME_TEXT_H
+    const char* base = strrchr(argv[3], '/');
+    base = base ? base + 1 : argv[3];
+    char guard[MAX_NAME];
+    size_t g = 0;
+    for (; base[g] && g < sizeof(guard) - 1; g++) {
+        guard[g] = isNameChar(base[g]) ? (base[g] >= 'a' && base[g] <= 'z' ? base[g] - 32 : base[g]) : '_';
+    }
+    guard[g] = '\0';
+
+    fprintf(c, "// Generated by tools/textenc from %s, do not edit\n\n#include \"%s\"\n\n", inPath, base);
+    fprintf(h, "// Generated by tools/textenc from %s, do not edit\n\n#ifndef %s\n#define %s\n\n#include <gb/gb.h>\n\n", inPath, guard, guard);
+
+    char line[MAX_LINE];
+    int lineNumber = 0;
+    int status = 0;
+    while (fgets(line, sizeof(line), in)) {
+        lineNumber++;
+        stripNewline(line);
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        if (strncmp(line, "@font ", 6) == 0) {
+            strcpy(glyphs, line + 6);
+            glyphsCount = strlen(glyphs);
+            int zero = glyphIndex('0');
+            for (int d = 0; d < 10; d++) {
+                if (zero < 0 || glyphIndex('0' + d) != zero + d) {
+                    fprintf(stderr, "%s:%d: digits 0-9 must be contiguous in the font\n", inPath, lineNumber);
+                    return 1;
+                }
+            }
+            fprintf(h, "// Font tiles are loaded at the end of the tiles space\n");
+            fprintf(h, "#define FONT_GLYPHS %u\n", (unsigned)glyphsCount);
+            fprintf(h, "#define FONT_TILE_NUM_START %u\n", (unsigned)(256 - glyphsCount));
+            fprintf(h, "#define FONT_DIGIT_START %u\n\n", (unsigned)(256 - glyphsCount + zero));
+            continue;
+        }
+
+        char name[MAX_NAME];
+        size_t n = 0;
+        const char* p = line;
+        while (isNameChar(*p) && n < sizeof(name) - 1) {
+            name[n++] = *p++;
+        }
+        name[n] = '\0';
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        const char* end = (*p == '"') ? strrchr(p + 1, '"') : NULL;
+        if (n == 0 || !end) {
+            fprintf(stderr, "%s:%d: expected name \"TEXT\"\n", inPath, lineNumber);
+            status = 1;
+            continue;
+        }
+        if (glyphsCount == 0) {
+            fprintf(stderr, "%s:%d: @font must come before strings\n", inPath, lineNumber);
+            return 1;
+        }
+        p++;
+
+        fprintf(c, "const uint8_t text_%s[] = {", name);
+        for (const char* ch = p; ch < end; ch++) {
+            int index = glyphIndex(*ch);
+            if (index < 0) {
+                fprintf(stderr, "%s:%d: '%c' is not in the font\n", inPath, lineNumber, *ch);
+                status = 1;
+                index = 0;
+            }
+            fprintf(c, "%s%u", ch == p ? " " : ", ", (unsigned)(256 - glyphsCount + index));
+        }
+        fprintf(c, " };\n");
+        fprintf(h, "#define text_%s_length %u\n", name, (unsigned)(end - p));
+        fprintf(h, "extern const uint8_t text_%s[];\n", name);
+    }
+    fprintf(h, "\n#endif\n");
+
+    fclose(in);
+    fclose(c);
+    fclose(h);
+    if (status) {
+        remove(argv[2]);
+        remove(argv[3]);
+    }
+    return status;
+}
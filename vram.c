@@ -0,0 +1,69 @@
+#include <gb/cgb.h>
+#include <gb/gb.h>
+#include <string.h>
+
+#include "vram.h"
+
+extern uint8_t cgbMode;
+
+// HDMA ignores the low 4 bits of the source address: unaligned tile data (metasprites) goes through this buffer
+#define BOUNCE_TILES 16
+uint8_t bounceBuffer[(BOUNCE_TILES << 4) + 15];
+
+// General-purpose DMA of whole tiles (at most 128 per transfer). The CPU is halted until the copy completes.
+void gdmaTiles(uint16_t dst, const uint8_t* src, uint8_t count) {
+    HDMA1_REG = (uint16_t)src >> 8;
+    HDMA2_REG = (uint16_t)src & 0xF0;
+    HDMA3_REG = (dst >> 8) & 0x1F;
+    HDMA4_REG = dst & 0xF0;
+    HDMA5_REG = count - 1;  // Bit 7 cleared: general-purpose mode, length in 16-byte blocks minus one
+}
+
+void dmaTiles(uint16_t dst, uint8_t count, const uint8_t* data) {
+    if (((uint16_t)data & 0x0F) == 0 && !VRAM_BOUNCE_ALL) {
+        while (count) {
+            uint8_t chunk = (count > 128) ? 128 : count;
+            gdmaTiles(dst, data, chunk);
+            dst += (uint16_t)chunk << 4;
+            data += (uint16_t)chunk << 4;
+            count -= chunk;
+        }
+    } else {
+        uint8_t* buffer = (uint8_t*)(((uint16_t)bounceBuffer + 15) & 0xFFF0);
+        while (count) {
+            uint8_t chunk = (count > BOUNCE_TILES) ? BOUNCE_TILES : count;
+            memcpy(buffer, data, (uint16_t)chunk << 4);
+            gdmaTiles(dst, buffer, chunk);
+            dst += (uint16_t)chunk << 4;
+            data += (uint16_t)chunk << 4;
+            count -= chunk;
+        }
+    }
+}
+
+void uploadBkgData(uint8_t first, uint8_t count, const uint8_t* data) {
+    if (!cgbMode) {
+        set_bkg_data(first, count, data);
+        return;
+    }
+    // With 0x8800 addressing (LCDC bit 4 cleared), tiles 0-127 live at 0x9000 and tiles 128-255 are shared with sprites
+    if (first < 128 && !(LCDC_REG & 0x10)) {
+        uint8_t low = 128 - first;
+        if (low > count)    low = count;
+        dmaTiles(0x9000 + ((uint16_t)first << 4), low, data);
+        first += low;
+        count -= low;
+        data += (uint16_t)low << 4;
+    }
+    if (count) {
+        dmaTiles(0x8000 + ((uint16_t)first << 4), count, data);
+    }
+}
+
+void uploadSpriteData(uint8_t first, uint8_t count, const uint8_t* data) {
+    if (!cgbMode) {
+        set_sprite_data(first, count, data);
+        return;
+    }
+    dmaTiles(0x8000 + ((uint16_t)first << 4), count, data);
+}
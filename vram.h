@@ -0,0 +1,15 @@
+#ifndef VRAM_H
+#define VRAM_H
+
+#include <gb/gb.h>
+
+// Copy all tile data through the bounce buffer on CGB, to compare screen load times (telemetry) with GDMA straight from ROM
+#define VRAM_BOUNCE_ALL 0
+
+// Tile data uploads: general-purpose DMA on CGB, CPU copy on DMG.
+// Tilesets are linked in ROM bank 1 (see the Makefile), their tile arrays are 16-byte aligned for DMA.
+// Window tiles share the background tile data, so uploadBkgData() is also used for the window.
+void uploadBkgData(uint8_t first, uint8_t count, const uint8_t* data);
+void uploadSpriteData(uint8_t first, uint8_t count, const uint8_t* data);
+
+#endif